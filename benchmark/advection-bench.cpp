@@ -2,6 +2,10 @@
 #include "bench_utils.hpp"
 #include <AdvectionParams.hpp>
 #include <AdvectionSolver.hpp>
+#include <CachedAdvectionSolver.hpp>
+#include <SpectralSolver.hpp>
+#include <SplineSolver.hpp>
+#include <optional>
 #include <sycl/sycl.hpp>
 #include <init.hpp>
 #include <validation.hpp>
@@ -14,7 +18,13 @@
 
 // ==========================================
 // ==========================================
+/* Solver of a benchmark: the Lagrange stencils computed in the kernel or
+read from the coefficient cache, cubic splines or spectral shifts. The err
+counter compares their accuracy. */
+enum class BenchSolver { Lagrange, CoefCache, Spline, Spectral };
+
 /* Benchmark the impact of wg_size on Hierarchical kernel */
+template <BenchSolver Solver>
 static void
 BM_Advection(benchmark::State &state) {
 
@@ -35,22 +45,37 @@ BM_Advection(benchmark::State &state) {
     Q.wait();
     
     /* Advector setup */
-    AdvectionSolver solver(params);
     auto optim_params = create_optim_params<ADVParams>(Q, params);
     auto impl_str = state.range(1) == 0 ? "ndrange" : "adaptivewg";
-    auto bkma_run_function = impl_selector<AdvectionSolver>(impl_str);
+    BkmaContext ctx(Q);
+    auto global_scratch = ctx.scratch(optim_params, n1);
 
     /* Benchmark */
-    for (auto _ : state) {
-        try {
-            bkma_run_function(Q, data, solver, optim_params, span3d_t{});
-            Q.wait();
-        } catch (const sycl::exception &e) {
-            state.SkipWithError(e.what());
-        } catch (const std::exception &e) {
-            state.SkipWithError(e.what());
-            break;
+    auto bench = [&](const auto &solver) {
+        using MySolver = std::decay_t<decltype(solver)>;
+        auto bkma_run_function = impl_selector<MySolver>(impl_str);
+        for (auto _ : state) {
+            try {
+                bkma_run_function(Q, data, solver, optim_params,
+                                  global_scratch, {});
+                Q.wait();
+            } catch (const sycl::exception &e) {
+                state.SkipWithError(e.what());
+            } catch (const std::exception &e) {
+                state.SkipWithError(e.what());
+                break;
+            }
         }
+    };
+    if constexpr (Solver == BenchSolver::CoefCache) {
+        AdvectionCoefCache cache(Q, params);
+        bench(cache.solver());
+    } else if constexpr (Solver == BenchSolver::Spline) {
+        bench(SplineSolver(params));
+    } else if constexpr (Solver == BenchSolver::Spectral) {
+        bench(SpectralSolver(params));
+    } else {
+        bench(AdvectionSolver(params));
     }
 
     params.maxIter = state.iterations();
@@ -82,7 +107,47 @@ BM_Advection(benchmark::State &state) {
 }
 
 // ==========================================
-BENCHMARK(BM_Advection)->Name("main-BKM-bench")
+BENCHMARK_TEMPLATE(BM_Advection, BenchSolver::Lagrange)
+    ->Name("main-BKM-bench")
+    ->ArgsProduct({
+        {/*0, */1}, /*gpu*/
+        IMPL_RANGE, /* impl */
+        benchmark::CreateDenseRange(0, 9, 1), /*size from the array*/
+        {128, 1024},         /*w*/
+        SEQ_SIZE0,
+        SEQ_SIZE2,
+    })
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(BM_Advection, BenchSolver::CoefCache)
+    ->Name("coef-cache-bench")
+    ->ArgsProduct({
+        {/*0, */1}, /*gpu*/
+        IMPL_RANGE, /* impl */
+        benchmark::CreateDenseRange(0, 9, 1), /*size from the array*/
+        {128, 1024},         /*w*/
+        SEQ_SIZE0,
+        SEQ_SIZE2,
+    })
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(BM_Advection, BenchSolver::Spline)
+    ->Name("spline-bench")
+    ->ArgsProduct({
+        {/*0, */1}, /*gpu*/
+        IMPL_RANGE, /* impl */
+        benchmark::CreateDenseRange(0, 9, 1), /*size from the array*/
+        {128, 1024},         /*w*/
+        SEQ_SIZE0,
+        SEQ_SIZE2,
+    })
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(BM_Advection, BenchSolver::Spectral)
+    ->Name("spectral-bench")
     ->ArgsProduct({
         {/*0, */1}, /*gpu*/
         IMPL_RANGE, /* impl */
@@ -17,7 +17,7 @@ struct BenchParams {
     BenchParams(benchmark::State &state)
         : gpu(state.range(0)),
           n0(-1), n1(-1), n2(-1),
-          w(state.range(3)),
+          w(state.range(3)), percent_loc(100),
           s0(state.range(4)), s2(state.range(5)) {
         
             init_params();
@@ -0,0 +1,128 @@
+#include "bench_utils.hpp"
+#include <AdvectionParams.hpp>
+#include <AdvectionSolver.hpp>
+#include <exception>
+#include <memory>
+#include <sycl/sycl.hpp>
+#include <thread>
+#include <vector>
+#include <init.hpp>
+
+#include <bkma.hpp>
+#include <types.hpp>
+
+static constexpr size_t STEPS_PER_ITER = 10;
+
+// ==========================================
+// ==========================================
+/* Everything a host thread owns to run its own problem: nothing is shared
+between threads but the device */
+struct Problem {
+    sycl::queue Q;
+    BkmaContext ctx;
+    AdvectionSolver solver;
+    BkmaOptimParams optim_params;
+    span3d_t data;
+    size_t nw;
+
+    Problem(const sycl::device &d, const ADVParams &params)
+        : Q(d), ctx(Q), solver(params),
+          optim_params(create_optim_params<ADVParams>(Q, params)),
+          data(sycl_alloc(params.n0 * params.n1 * params.n2, Q), params.n0,
+               params.n1, params.n2),
+          nw(params.n1 - (solver.window() - 1)) {
+        Q.wait();
+        fill_buffer_adv(Q, data, params);
+        optim_params.work_counters = ctx.work_counters();
+    }
+
+    ~Problem() { sycl::free(data.data_handle(), Q); }
+
+    void run(const size_t n_steps) {
+        for (size_t t = 0; t < n_steps; ++t)
+            bkma_run<AdvectionSolver, BkmaImpl::AdaptiveWg>(
+                Q, data, solver, optim_params, ctx.scratch(optim_params, nw))
+                .wait();
+    }
+};
+
+// ==========================================
+// ==========================================
+/* Combined throughput of many small advection problems, each one driven by
+its own host thread and queue on the same device */
+static void
+BM_ConcurrentAdvection(benchmark::State &state) {
+    const auto n_threads = static_cast<size_t>(state.range(1));
+
+    ADVParams params;
+    params.gpu = state.range(0);
+    params.n0 = state.range(2);
+    params.n1 = 1024;
+    params.n2 = 1;
+    params.pref_wg_size = 128;
+    params.seq_size0 = 1;
+    params.seq_size2 = 1;
+    params.update_deltas();
+
+    auto device = createSyclQueue(params.gpu, state).get_device();
+
+    std::vector<std::unique_ptr<Problem>> problems;
+    for (size_t i = 0; i < n_threads; ++i)
+        problems.push_back(std::make_unique<Problem>(device, params));
+
+    /* Warmup to JIT the kernels */
+    problems.front()->run(1);
+
+    for (auto _ : state) {
+        /* An exception escaping a thread would terminate, it is rethrown
+        after the join */
+        std::vector<std::exception_ptr> errors(problems.size());
+        try {
+            std::vector<std::thread> threads;
+            for (size_t i = 0; i < problems.size(); ++i)
+                threads.emplace_back([&problem = *problems[i],
+                                      &error = errors[i]]() {
+                    try {
+                        problem.run(STEPS_PER_ITER);
+                    } catch (...) {
+                        error = std::current_exception();
+                    }
+                });
+            for (auto &t : threads)
+                t.join();
+            for (const auto &error : errors)
+                if (error)
+                    std::rethrow_exception(error);
+        } catch (const std::exception &e) {
+            state.SkipWithError(e.what());
+            break;
+        }
+    }
+
+    const auto n_cells = params.n0 * params.n1 * params.n2;
+    state.SetItemsProcessed(state.iterations() * n_threads * STEPS_PER_ITER *
+                            n_cells);
+    state.SetBytesProcessed(state.iterations() * n_threads * STEPS_PER_ITER *
+                            n_cells * sizeof(real_t) * 2);
+
+    state.counters.insert({{"gpu", params.gpu},
+                           {"threads", n_threads},
+                           {"n0", params.n0},
+                           {"n1", params.n1},
+                           {"n2", params.n2}});
+}
+
+// ==========================================
+BENCHMARK(BM_ConcurrentAdvection)
+    ->Name("concurrent-bench")
+    ->ArgsProduct({
+        {1},                                        /*gpu*/
+        benchmark::CreateRange(1, 16, 2),           /*threads*/
+        benchmark::CreateRange(1 << 4, 1 << 10, 4), /*n0*/
+    })
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+// ==========================================
+// ==========================================
+BENCHMARK_MAIN();
@@ -64,18 +64,21 @@ BkmaOptimParams
 create_bkma_params(sycl::queue &q, const size_t n0, const size_t n1,
                    const size_t n2, const size_t w) {
 
+    const auto &dev = DeviceProfile::get(q.get_device());
     WorkItemDispatch wi_dispatch;
     wi_dispatch.set_ideal_sizes(w, n0, n1, n2);
-    auto max_elem_local_mem =
-        q.get_device().get_info<sycl::info::device::local_mem_size>() /
-        sizeof(real_t);
-    wi_dispatch.adjust_sizes_mem_limit(max_elem_local_mem, n1);
+    wi_dispatch.adjust_sizes_mem_limit(dev.local_mem_size / sizeof(real_t),
+                                       n1);
 
     WorkGroupDispatch wg_dispatch;
-    wg_dispatch.set_num_work_groups(n0, n2, 1, 1, wi_dispatch.w0_,
+    auto [dispatch_d0, dispatch_d2] =
+        plan_batchs(dev, n0, n2, wi_dispatch.w0_, wi_dispatch.w2_,
+                    wg_dispatch, MemorySpace::Local, n1);
+    wg_dispatch.set_num_work_groups(n0, n2, dispatch_d0.n_batch_,
+                                    dispatch_d2.n_batch_, wi_dispatch.w0_,
                                     wi_dispatch.w2_);
 
-    return {{1, n0, n0},     {1, n2, n2}, wi_dispatch.w0_,   wi_dispatch.w1_,
+    return {dispatch_d0,     dispatch_d2, wi_dispatch.w0_,   wi_dispatch.w1_,
             wi_dispatch.w2_, wg_dispatch, MemorySpace::Local};
 }
 
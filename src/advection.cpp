@@ -1,6 +1,10 @@
 #include <AdvectionParams.hpp>
 #include <AdvectionSolver.hpp>
+#include <CachedAdvectionSolver.hpp>
+#include <SpectralSolver.hpp>
+#include <SplineSolver.hpp>
 #include <iostream>
+#include <optional>
 #include <sycl/sycl.hpp>
 #include <init.hpp>
 #include <validation.hpp>
@@ -8,6 +12,137 @@
 #include <bkma.hpp>
 #include <types.hpp>
 #include <impl_selector.hpp>
+#include <autotuner.hpp>
+#include <online_tuner.hpp>
+#include <explain_plan.hpp>
+#include <multi_device.hpp>
+
+// ==========================================
+// ==========================================
+/* Time loop with the n0 lines split across the devices of md */
+template <class MySolver, BkmaImpl Impl>
+double
+run_multi_device(BkmaMultiDevice &md, span3d_t data, const MySolver &solver,
+                 const size_t maxIter) {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t t = 0; t < maxIter; ++t)
+        md.run<MySolver, Impl>(data, solver).wait();
+    auto end = std::chrono::high_resolution_clock::now();
+
+    const std::chrono::duration<double> elapsed_seconds = end - start;
+    return elapsed_seconds.count();
+}   // end run_multi_device
+
+// ==========================================
+// ==========================================
+/* Picks the implementation and the dispatch for solver, then runs the time
+loop on data. Returns the duration of the time loop in seconds. */
+template <class MySolver>
+double
+run_single_device(sycl::queue &Q, const ADVParamsNonCopyable &strParams,
+                  ADVParams &params, span3d_t data, const MySolver &solver) {
+    const auto n1 = params.n1;
+    const auto n0 = params.n0;
+    const auto n2 = params.n2;
+    const auto maxIter = params.maxIter;
+    constexpr bool passes = HasLinePasses<MySolver>::value;
+
+    /* Owns the global scratch and work counters, reused by every call */
+    BkmaContext ctx(Q);
+    const auto nw = n1 - (solver.window() - 1);
+    auto run_impl = [&](BkmaImpl impl, span3d_t d, BkmaOptimParams p,
+                        const std::vector<sycl::event> &deps = {}) {
+        p.work_counters = ctx.work_counters();
+        return visit_impl(impl, [&](auto I) {
+            return bkma_run<MySolver, decltype(I)::value>(
+                Q, d, solver, p, ctx.scratch(p, nw), deps);
+        });
+    };
+
+    auto optim_params = create_optim_params<ADVParams>(Q, params, passes);
+
+    /* Requested implementation checked against its capabilities, or the
+    fastest eligible one with auto */
+    BkmaImpl impl;
+    if (auto requested = impl_from_string(strParams.kernelImpl)) {
+        impl = *requested;
+        check_impl(Q, impl, optim_params, n1, solver.window(), passes);
+    } else {
+        span3d_t tuning_data(sycl_alloc(n0 * n1 * n2, Q), n0, n1, n2);
+        Q.wait();
+        fill_buffer_adv(Q, tuning_data, params);
+        impl = fastest_impl(Q, optim_params, n1, solver.window(), passes,
+                            [&](BkmaImpl i) {
+                                return run_impl(i, tuning_data, optim_params);
+                            });
+        sycl::free(tuning_data.data_handle(), Q);
+    }
+    auto run = [&](span3d_t d, BkmaOptimParams p,
+                   const std::vector<sycl::event> &deps = {}) {
+        return run_impl(impl, d, p, deps);
+    };
+    const auto allow_global = visit_impl(impl, [](auto I) {
+        return ImplTraits<decltype(I)::value>::global_scratch;
+    });
+
+    const auto tuning = to_lowercase(strParams.tuning);
+    if (tuning == "model") {
+        optim_params = model_optim_params<ADVParams>(Q, params, solver.window(),
+                                                     allow_global);
+    } else if (tuning == "autotune") {
+        /* Tune on a copy so that the initial condition is preserved */
+        span3d_t tuning_data(sycl_alloc(n0 * n1 * n2, Q), n0, n1, n2);
+        Q.wait();
+        fill_buffer_adv(Q, tuning_data, params);
+        optim_params = tuned_optim_params(
+            Q, params, "advection-" + to_lowercase(impl_to_string(impl)),
+            strParams.tuning_db,
+            [&](const BkmaOptimParams &p) { return run(tuning_data, p); });
+        sycl::free(tuning_data.data_handle(), Q);
+    }
+
+    explain_plan(std::cout,
+                 make_execution_plan(Q, params, optim_params,
+                                     impl_to_string(impl), solver.window(),
+                                     params.steps_in_flight),
+                 to_lowercase(strParams.explain_plan));
+
+    std::optional<OnlineTuner> online_tuner;
+    if (tuning == "online")
+        online_tuner.emplace(
+            online_candidates<ADVParams>(Q, params, impl, solver.window(),
+                                         passes),
+            params.online_trials);
+
+    /* Steps enqueued ahead, each one depends on the previous one */
+    StepsInFlight steps(params.steps_in_flight);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    // Time loop
+    for (size_t t = 0; t < maxIter; ++t) {
+        if (online_tuner && online_tuner->exploring()) {
+            auto iter_start = std::chrono::high_resolution_clock::now();
+            run(data, online_tuner->current());
+            Q.wait();
+            const std::chrono::duration<double> iter_seconds =
+                std::chrono::high_resolution_clock::now() - iter_start;
+            online_tuner->record(iter_seconds.count());
+            if (!online_tuner->exploring())
+                optim_params = online_tuner->current();
+            continue;
+        }
+
+        steps.push([&](const std::vector<sycl::event> &deps) {
+            return run(data, optim_params, deps);
+        });
+
+    }   // end for t < T
+    Q.wait();
+    auto end = std::chrono::high_resolution_clock::now();
+    const std::chrono::duration<double> elapsed_seconds = end - start;
+
+    return elapsed_seconds.count();
+}   // end run_single_device
 
 // ==========================================
 // ==========================================
@@ -24,7 +159,7 @@ main(int argc, char **argv) {
     auto device = pick_device(run_on_gpu);
     strParams.gpu = device.is_gpu() ? true : false;
 
-    sycl::queue Q{device};
+    sycl::queue Q{device, rethrow_async_errors};
 
     /* Display infos on current device */
     std::cout << "Using device: "
@@ -38,6 +173,72 @@ main(int argc, char **argv) {
     const auto n0 = params.n0;
     const auto n2 = params.n2;
     const auto maxIter = params.maxIter;
+
+    const auto interpolation = to_lowercase(strParams.interpolation);
+    if (interpolation != "lagrange" && interpolation != "spline" &&
+        interpolation != "spectral")
+        throw std::invalid_argument("Unknown interpolation " +
+                                    strParams.interpolation);
+
+    const auto multi_device = to_lowercase(strParams.multi_device);
+    if (multi_device != "none") {
+        if (interpolation != "lagrange")
+            throw std::invalid_argument(
+                "Only the Lagrange interpolation runs on several devices");
+        /* The coefficient cache lives on a single queue, and fastest_impl
+        times a single device */
+        if (params.coef_cache)
+            throw std::invalid_argument(
+                "coef_cache is not supported with multi_device");
+        const auto requested = impl_from_string(strParams.kernelImpl);
+        if (!requested)
+            throw std::invalid_argument(
+                "kernelImpl = auto is not supported with multi_device, "
+                "name an implementation");
+        /* Each slice keeps the heuristic dispatch of its device and the
+        steps are synchronous */
+        if (to_lowercase(strParams.tuning) != "heuristic")
+            throw std::invalid_argument(
+                "tuning = " + strParams.tuning +
+                " is not supported with multi_device, use heuristic");
+        if (params.steps_in_flight != 1)
+            throw std::invalid_argument(
+                "steps_in_flight is not supported with multi_device, use 1");
+        if (to_lowercase(strParams.explain_plan) != "none")
+            throw std::invalid_argument(
+                "explain_plan is not supported with multi_device, use none");
+        BkmaMultiDevice md(select_devices(device, multi_device));
+        md.plan(params);
+        std::cout << "Lines split across " << md.n_slices() << " devices\n";
+
+        /* Each slice is first touched by the device that updates it */
+        auto data = md.alloc(n0, n1, n2);
+        for (size_t i = 0; i < md.n_slices(); ++i) {
+            auto slice = md.slice(data, i);
+            fill_buffer_adv(md.queue(i), slice,
+                            BkmaMultiDevice::params_of_slice(
+                                params, i, md.n_slices()));
+        }
+
+        const auto impl = *requested;
+        const auto seconds = visit_lag_order(params.lag_order, [&](auto O) {
+            using MySolver = LagrangeSolver<decltype(O)::value>;
+            const MySolver solver(params);
+            for (size_t i = 0; i < md.n_slices(); ++i)
+                check_impl(md.queue(i), impl, md.optim_params(i), n1,
+                           solver.window());
+            return visit_impl(impl, [&](auto I) {
+                return run_multi_device<MySolver, decltype(I)::value>(
+                    md, data, solver, maxIter);
+            });
+        });
+
+        validate_result_adv(md.queue(0), data, params);
+        print_perf(seconds, n0 * n1 * n2 * maxIter);
+
+        md.free(data);
+        return 0;
+    }
     
     /* Buffer for the distribution function containing the probabilities of
     having a particle at a particular speed and position, plus a fictive dim */
@@ -45,25 +246,42 @@ main(int argc, char **argv) {
     Q.wait();
     fill_buffer_adv(Q, data, params);
     
-    AdvectionSolver solver(params);
-    auto optim_params = create_optim_params<ADVParams>(Q, params);
-
-    auto bkma_run_function = impl_selector<AdvectionSolver>(strParams.kernelImpl);
-
-    auto start = std::chrono::high_resolution_clock::now();
-    // Time loop
-    for (size_t t = 0; t < maxIter; ++t) {
-        bkma_run_function(Q, data, solver, optim_params, span3d_t{});
-        Q.wait();
-
-    }   // end for t < T
-    auto end = std::chrono::high_resolution_clock::now();
-    const std::chrono::duration<double> elapsed_seconds = end - start;
+    /* Lagrange solvers instantiated for the interpolation order, and for n1
+    when the build has specialized kernels for it. The coefficient cache is
+    built once before the time loop */
+    double seconds;
+    if (interpolation == "spline")
+        seconds = run_single_device(Q, strParams, params, data,
+                                    SplineSolver(params));
+    else if (interpolation == "spectral")
+        seconds = run_single_device(Q, strParams, params, data,
+                                    SpectralSolver(params));
+    else
+        seconds = visit_lag_order(params.lag_order, [&](auto O) {
+            constexpr int Order = decltype(O)::value;
+            return visit_fixed_n1(n1, [&](auto N) {
+                constexpr size_t N1 = decltype(N)::value;
+                if (N1 != 0)
+                    std::cout << "Kernels specialized for n1 = " << N1
+                              << "\n";
+                if (params.coef_cache) {
+                    AdvectionCoefCache<Order> cache(Q, params);
+                    std::cout
+                        << "Rotated velocities: "
+                        << AdvectionCoefCache<Order>::n_rotations(params)
+                        << " of " << n0 << "\n";
+                    return run_single_device(Q, strParams, params, data,
+                                             cache.template solver<N1>());
+                }
+                return run_single_device(Q, strParams, params, data,
+                                         LagrangeSolver<Order, N1>(params));
+            });
+        });
 
     validate_result_adv(Q, data, params);
 
     auto const n_cells = n0 * n1 * n2 * (maxIter);
-    print_perf(elapsed_seconds.count(), n_cells);
+    print_perf(seconds, n_cells);
 
     sycl::free(data.data_handle(), Q);
     Q.wait();
@@ -5,6 +5,7 @@ ADVParams::ADVParams(ADVParamsNonCopyable &other) {
     n1 = other.n1;
     n0 = other.n0;
     n2 = other.n2;
+    lag_order = other.lag_order;
 
     maxIter = other.maxIter;
     gpu = other.gpu;
@@ -13,6 +14,12 @@ ADVParams::ADVParams(ADVParamsNonCopyable &other) {
     percent_loc = other.percent_loc;
     seq_size0 = other.seq_size0;
     seq_size2 = other.seq_size2;
+    batchs_in_flight = other.batchs_in_flight;
+    max_scratch_mb = other.max_scratch_mb;
+    steps_in_flight = other.steps_in_flight;
+    online_trials = other.online_trials;
+    coef_cache = other.coef_cache;
+    shift_tol = other.shift_tol;
 
     pref_wg_size = other.pref_wg_size;
 
@@ -34,6 +41,7 @@ ADVParamsNonCopyable::ADVParamsNonCopyable(ADVParams &other) {
     n1 = other.n1;
     n0 = other.n0;
     n2 = other.n2;
+    lag_order = other.lag_order;
 
     maxIter = other.maxIter;
     gpu = other.gpu;
@@ -42,6 +50,12 @@ ADVParamsNonCopyable::ADVParamsNonCopyable(ADVParams &other) {
     percent_loc = other.percent_loc;
     seq_size0 = other.seq_size0;
     seq_size2 = other.seq_size2;
+    batchs_in_flight = other.batchs_in_flight;
+    max_scratch_mb = other.max_scratch_mb;
+    steps_in_flight = other.steps_in_flight;
+    online_trials = other.online_trials;
+    coef_cache = other.coef_cache;
+    shift_tol = other.shift_tol;
 
     pref_wg_size = other.pref_wg_size;
 
@@ -68,6 +82,9 @@ ADVParamsNonCopyable::setup(const ConfigMap &configMap) {
     n0 = configMap.getInteger("problem", "n0", 1024);
     n2 = configMap.getInteger("problem", "n2", 1024);
     maxIter = configMap.getInteger("problem", "maxIter", 50);
+    lag_order = configMap.getInteger("problem", "lag_order", 5);
+    interpolation =
+        configMap.getString("problem", "interpolation", "lagrange");
 
     dt = configMap.getFloat("problem", "dt", 0.0001);
     minRealX = configMap.getFloat("problem", "minRealX", 0.0);
@@ -82,11 +99,25 @@ ADVParamsNonCopyable::setup(const ConfigMap &configMap) {
     // optimization
     gpu = configMap.getBool("optimization", "gpu", true);
     pref_wg_size = configMap.getInteger("optimization", "pref_wg_size", 512);
+    tuning = configMap.getString("optimization", "tuning", "heuristic");
+    tuning_db =
+        configMap.getString("optimization", "tuning_db", "bkma_tuning.db");
+    multi_device = configMap.getString("optimization", "multi_device", "none");
+    online_trials = configMap.getInteger("optimization", "online_trials", 2);
     seq_size0 = configMap.getInteger("optimization", "seq_size0", 1);
     seq_size2 = configMap.getInteger("optimization", "seq_size2", 1);
+    percent_loc = configMap.getFloat("optimization", "percent_loc", 1.0);
+    batchs_in_flight =
+        configMap.getInteger("optimization", "batchs_in_flight", 1);
+    max_scratch_mb = configMap.getInteger("optimization", "max_scratch_mb", 0);
+    steps_in_flight =
+        configMap.getInteger("optimization", "steps_in_flight", 1);
+    coef_cache = configMap.getBool("optimization", "coef_cache", false);
+    shift_tol = configMap.getFloat("optimization", "shift_tol", 0.0);
 
     // io
     outputSolution = configMap.getBool("io", "outputSolution", false);
+    explain_plan = configMap.getString("io", "explain_plan", "none");
 
     update_deltas();
 }   // ADVParams::setup
@@ -116,9 +147,19 @@ ADVParamsNonCopyable::print() {
     std::cout << "n0 (nvx)    : " << n0 << std::endl;
     std::cout << "n1 (nx)     : " << n1 << std::endl;
     std::cout << "n2          : " << n2 << std::endl;
+    std::cout << "interp      : " << interpolation << std::endl;
+    std::cout << "lag_order   : " << lag_order << std::endl;
     std::cout << "pref_wg_size: " << pref_wg_size << std::endl;
+    std::cout << "tuning      : " << tuning << std::endl;
+    std::cout << "multi_device: " << multi_device << std::endl;
     std::cout << "seq_size0   : " << seq_size0 << std::endl;
     std::cout << "seq_size2   : " << seq_size2 << std::endl;
+    std::cout << "percent_loc : " << percent_loc << std::endl;
+    std::cout << "in_flight   : " << batchs_in_flight << std::endl;
+    std::cout << "steps_flight: " << steps_in_flight << std::endl;
+    std::cout << "scratch_mb  : " << max_scratch_mb << std::endl;
+    std::cout << "coef_cache  : " << coef_cache << std::endl;
+    std::cout << "shift_tol   : " << shift_tol << std::endl;
     std::cout << "dt          : " << dt << std::endl;
     std::cout << "dx          : " << dx << std::endl;
     std::cout << "dvx         : " << dvx << std::endl;
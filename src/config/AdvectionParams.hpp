@@ -14,7 +14,8 @@ struct ADVParams {
   // Running on the GPU (false = CPU)
   bool gpu = false;
 
-  //The percentage of n0 rows to compute in local memory
+  //The percentage of n0 rows to compute in local memory, the others use a
+  //global scratch. A negative value lets the device occupancy decide.
   float percent_loc = 1.0;
 
   // Outputs the solution to solution.log file to be read with the ipynb
@@ -29,6 +30,9 @@ struct ADVParams {
   size_t n2 = 32;   //stride for x, is also a batch dimension
   //We get n2*n0 independent problems of size n1, and x has a stride of n2
 
+  //Order of the Lagrange interpolation: 3, 5, 7 or 9
+  int lag_order = 5;
+
   // Sizes of the SYCL work groups
   size_t pref_wg_size = 128;
   
@@ -36,6 +40,26 @@ struct ADVParams {
   size_t seq_size0;
   size_t seq_size2;
 
+  //Number of batches submitted before the host waits on the oldest one
+  size_t batchs_in_flight = 1;
+
+  //Time steps enqueued before the host waits on the oldest one (1 = a wait
+  //after every step)
+  size_t steps_in_flight = 1;
+
+  //Cap on the global scratch in MB (0 = device allocation limit)
+  size_t max_scratch_mb = 0;
+
+  //Iterations spent on each candidate configuration by the online tuning
+  size_t online_trials = 2;
+
+  //Precompute the stencil of each velocity once (valid for a constant dt)
+  bool coef_cache = false;
+
+  //With coef_cache, velocities whose displacement is within shift_tol cell
+  //of a whole number of cells are advanced by an exact rotation
+  real_t shift_tol = 0;
+
   // Deltas : taille physique d'une cellule discrète (en x, vx, t)
   real_t dt  = 0.0001;
   real_t dx;
@@ -61,10 +85,23 @@ struct ADVParamsNonCopyable : ADVParams {
   ADVParamsNonCopyable(ADVParams &other);
   ADVParamsNonCopyable() = default;
 
+  //Interpolation of the feet: lagrange (of order lag_order), spline or
+  //spectral
+  std::string interpolation;
+
   //The implementation of the kernel, correspond to core/impl cpp files
   std::string kernelImpl;
   bool inplace;
 
+  //How BkmaOptimParams are chosen: heuristic, model, autotune or online
+  std::string tuning;
+  //File caching the autotuning results
+  std::string tuning_db;
+  //Devices sharing the n0 lines: none, numa (sub-devices) or all
+  std::string multi_device;
+  //Report of the dispatch printed before the time loop: none, text or json
+  std::string explain_plan;
+
   //! setup / initialization
   void setup(const ConfigMap& configMap); 
 
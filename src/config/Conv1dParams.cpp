@@ -17,7 +17,11 @@ Conv1dParams::Conv1dParams(Conv1dParamsNonCopyable &other) {
     pref_wg_size = other.pref_wg_size;
     seq_size0 = other.seq_size0;
     seq_size2 = other.seq_size2;
+    batchs_in_flight = other.batchs_in_flight;
+    max_scratch_mb = other.max_scratch_mb;
+    percent_loc = other.percent_loc;
     inplace = other.inplace;
+    ragged_min_length = other.ragged_min_length;
 };
 
 Conv1dParamsNonCopyable::Conv1dParamsNonCopyable(Conv1dParams &other) {
@@ -36,7 +40,11 @@ Conv1dParamsNonCopyable::Conv1dParamsNonCopyable(Conv1dParams &other) {
     pref_wg_size = other.pref_wg_size;
     seq_size0 = other.seq_size0;
     seq_size2 = other.seq_size2;
+    batchs_in_flight = other.batchs_in_flight;
+    max_scratch_mb = other.max_scratch_mb;
+    percent_loc = other.percent_loc;
     inplace = other.inplace;
+    ragged_min_length = other.ragged_min_length;
 };
 
 // ======================================================
@@ -54,6 +62,8 @@ void Conv1dParamsNonCopyable::setup(const ConfigMap& configMap)
     n1 = length*channel_out;
     n2 = batch_size_n2;
     n_write = compute_output_size(length, k);
+    ragged_min_length =
+        configMap.getInteger("problem", "ragged_min_length", 0);
 
     // impl
     kernelImpl = configMap.getString("impl", "kernelImpl", "AdaptiveWg");
@@ -62,9 +72,19 @@ void Conv1dParamsNonCopyable::setup(const ConfigMap& configMap)
     // optimization
     gpu = configMap.getBool("optimization", "gpu", true);
     pref_wg_size = configMap.getInteger("optimization", "pref_wg_size", 512);
+    tuning = configMap.getString("optimization", "tuning", "heuristic");
+    tuning_db =
+        configMap.getString("optimization", "tuning_db", "bkma_tuning.db");
+
     seq_size0 = configMap.getInteger("optimization", "seq_size0", 1);
     seq_size2 = configMap.getInteger("optimization", "seq_size2", 1);
+    percent_loc = configMap.getFloat("optimization", "percent_loc", 1.0);
+    batchs_in_flight =
+        configMap.getInteger("optimization", "batchs_in_flight", 1);
+    max_scratch_mb = configMap.getInteger("optimization", "max_scratch_mb", 0);
 
+    // io
+    explain_plan = configMap.getString("io", "explain_plan", "none");
 } // Conv1dParams::setup
 
 // ======================================================
@@ -89,13 +109,18 @@ Conv1dParamsNonCopyable::print() {
     std::cout << "n1           : " << n1 << std::endl;
     std::cout << "n2           : " << n2 << std::endl;
     std::cout << "pref_wg_size : " << pref_wg_size << std::endl;
+    std::cout << "tuning       : " << tuning << std::endl;
     std::cout << "seq_size0    : " << seq_size0 << std::endl;
     std::cout << "seq_size2    : " << seq_size2 << std::endl;
+    std::cout << "percent_loc  : " << percent_loc << std::endl;
+    std::cout << "in_flight    : " << batchs_in_flight << std::endl;
+    std::cout << "scratch_mb   : " << max_scratch_mb << std::endl;
     std::cout << "batch_size   : " << total_batch_size << std::endl;
     std::cout << "length       : " << length << std::endl;
     std::cout << "channels(i/o): " << channel_in << std::endl;
     std::cout << "k            : " << k << std::endl;
     std::cout << "batch_n2     : " << batch_size_n2 << std::endl;
     std::cout << "n_write      : " << n_write << std::endl;
+    std::cout << "ragged_min   : " << ragged_min_length << std::endl;
     std::cout << std::endl;
 }   // Conv1dParams::print
@@ -23,10 +23,17 @@ struct Conv1dParams {
   size_t n2;
   size_t n_write;
 
+  //Lines of length ragged_min_length to length packed without padding,
+  //0 pads every line to length
+  size_t ragged_min_length = 0;
+
   bool gpu = true;
   short unsigned pref_wg_size = 512;
   size_t seq_size0 = 1;
   size_t seq_size2 = 1;
+  size_t batchs_in_flight = 1;
+  size_t max_scratch_mb = 0;
+  float percent_loc = 1.0;
   bool inplace = true;
 
   size_t compute_output_size(size_t Lin, short unsigned kernel_size);
@@ -38,6 +45,9 @@ struct Conv1dParamsNonCopyable : Conv1dParams {
   Conv1dParamsNonCopyable() = default;
 
   std::string kernelImpl;
+  std::string tuning;
+  std::string tuning_db;
+  std::string explain_plan;
 
   void setup(const ConfigMap& configMap); 
   void print();
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <vector>
 #include <sycl/sycl.hpp>
 
 #include <ConvSolver.hpp>
@@ -7,6 +8,56 @@
 #include <types.hpp>
 #include <init.hpp>
 #include <validation.hpp>
+#include <impl_selector.hpp>
+#include <autotuner.hpp>
+#include <explain_plan.hpp>
+
+// ==========================================
+// ==========================================
+/* n0 x n2 lines with lengths spread between ragged_min_length and length,
+packed without padding and updated by a single launch */
+void
+run_ragged(sycl::queue &Q, const Conv1dParams &params,
+           const ConvSolver &solver) {
+    if (params.ragged_min_length < params.k ||
+        params.ragged_min_length > params.length)
+        throw std::invalid_argument(
+            "ragged_min_length should be between k and length");
+
+    const auto n_lines = params.n0 * params.n2;
+    const auto spread = params.length - params.ragged_min_length + 1;
+    std::vector<size_t> lengths(n_lines);
+    for (size_t r = 0; r < n_lines; ++r)
+        lengths[r] = (params.ragged_min_length + (r * 7919) % spread) *
+                     params.channel_out;
+
+    RaggedBatch batch(Q, lengths, params.pref_wg_size);
+    auto data = sycl_alloc(batch.size(), Q);
+    std::cout << "Ragged lines: " << batch.size() << " cells packed instead of "
+              << n_lines * params.n1 << ", " << batch.n_tiles()
+              << " balanced tiles, "
+              << (batch.local_scratch() ? "local" : "global") << " scratch\n";
+
+    /* Warmup to JIT model */
+    Q.fill(data, real_t(1.0), batch.size()).wait();
+    for (int i = 0; i < 3; ++i)
+        submit_ragged(Q, batch, data, solver).wait();
+
+    Q.fill(data, real_t(7.3), batch.size()).wait();
+    auto start = std::chrono::high_resolution_clock::now();
+    submit_ragged(Q, batch, data, solver).wait();
+    auto end = std::chrono::high_resolution_clock::now();
+    const std::chrono::duration<double> elapsed_seconds = end - start;
+
+    std::cout << "PERF_DIAGS:" << std::endl;
+    std::cout << "elapsed_time: " << elapsed_seconds.count() << " s\n";
+    auto gcells = (batch.size() / elapsed_seconds.count()) / 1e9;
+    std::cout << "upd_cells_per_sec: " << gcells << " Gcell/sec\n";
+    std::cout << "estimated_throughput: " << gcells * sizeof(real_t) * 2
+              << " GB/s" << std::endl;
+
+    sycl::free(data, Q);
+}   // end run_ragged
 
 // ==========================================
 // ==========================================
@@ -22,7 +73,7 @@ main(int argc, char **argv) {
     auto device = pick_device(run_on_gpu);
     strParams.gpu = device.is_gpu() ? true : false;
 
-    sycl::queue Q{device};
+    sycl::queue Q{device, rethrow_async_errors};
 
     /* Display infos on current device */
     std::cout << "Using device: "
@@ -51,37 +102,53 @@ main(int argc, char **argv) {
 
     ConvSolver solver{weight, bias, k, c_in, length};
 
-    WorkItemDispatch wi_dispatch;
-    wi_dispatch.set_ideal_sizes(params.pref_wg_size, n0, n1, n2);
-    auto max_elem_local_mem =
-        Q.get_device().get_info<sycl::info::device::local_mem_size>() /
-        sizeof(real_t);
-    wi_dispatch.adjust_sizes_mem_limit(max_elem_local_mem, n1);
-
-    WorkGroupDispatch wg_dispatch;
-    wg_dispatch.set_num_work_groups(n0, n2, params.seq_size0, params.seq_size2,
-                                    wi_dispatch.w0_, wi_dispatch.w2_);
-
-    BkmaOptimParams optim_params{{1, n0, n0},       // BatchConfig1D dispatch_d0
-                                 {1, n2, n2},       // BatchConfig1D dispatch_d2
-                                 wi_dispatch.w0_,   // size_t w0
-                                 wi_dispatch.w1_,   // size_t w1
-                                 wi_dispatch.w2_,   // size_t w2
-                                 wg_dispatch,       // WorkGroupDispatch wg_disp
-                                 MemorySpace::Local};
+    if (params.ragged_min_length > 0) {
+        run_ragged(Q, params, solver);
+        for (auto ptr : {data.data_handle(), warmup_data.data_handle(),
+                         weight.data_handle(), bias.data_handle()})
+            sycl::free(ptr, Q);
+        return 0;
+    }
+
+    /* Owns the global scratch, reused by every bkma_run call */
+    BkmaContext ctx(Q);
+    const auto nw = n1 - (solver.window() - 1);
+
+    auto optim_params = create_optim_params<Conv1dParams>(Q, params);
+    const auto tuning = to_lowercase(strParams.tuning);
+    if (tuning == "model") {
+        optim_params =
+            model_optim_params<Conv1dParams>(Q, params, solver.window(), true);
+    } else if (tuning == "autotune") {
+        /* The warmup buffer is used for tuning */
+        optim_params = tuned_optim_params(
+            Q, params, "conv1d-adaptivewg", strParams.tuning_db,
+            [&](const BkmaOptimParams &p) {
+                return bkma_run<ConvSolver, BkmaImpl::AdaptiveWg>(
+                    Q, warmup_data, solver, p, ctx.scratch(p, nw));
+            });
+    }
 
     auto error = sum_and_normalize_conv1d(Q, data, n1);
     std::cout << std::endl;
     std::cout << "Normalized Array before: " << error << std::endl;
 
+    explain_plan(std::cout,
+                 make_execution_plan(Q, params, optim_params, "AdaptiveWg",
+                                     solver.window()),
+                 to_lowercase(strParams.explain_plan));
+
+    auto global_scratch = ctx.scratch(optim_params, nw);
+
     /* Warmup to JIT model */
     for (int i = 0; i < 3; ++i)
         bkma_run<ConvSolver, BkmaImpl::AdaptiveWg>(Q, warmup_data, solver,
-                                                   optim_params)
+                                                   optim_params, global_scratch)
             .wait();
 
     auto start = std::chrono::high_resolution_clock::now();
-    bkma_run<ConvSolver, BkmaImpl::AdaptiveWg>(Q, data, solver, optim_params)
+    bkma_run<ConvSolver, BkmaImpl::AdaptiveWg>(Q, data, solver, optim_params,
+                                               global_scratch)
         .wait();
     auto end = std::chrono::high_resolution_clock::now();
     const std::chrono::duration<double> elapsed_seconds = end - start;
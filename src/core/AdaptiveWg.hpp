@@ -1,5 +1,8 @@
 #pragma once
+#include <stdexcept>
+#include <utility>
 #include <bkma_tools.hpp>
+#include <DeviceProfile.hpp>
 
 // //==============================================================================
 // class AdaptiveWg : public IAdvectorX {
@@ -54,18 +57,168 @@
 
 // ==========================================
 // ==========================================
+/* Local memory path. A work-group stages its tile of w0 x w2 lines entirely
+(the periodic ghost cells of a line are the line itself) in local memory,
+work-items consecutive in dim2 reading consecutive cells of data. The solver
+then reads the tile from local memory, so that every input is loaded from
+global memory once per step, and the results are written straight back to
+data. The loops over the tiles are uniform in a work-group so that every
+work-item reaches the barriers. The line passes of a solver, if any, run on
+the staged tile before the interpolation, alternating with a second tile. */
 template <MemorySpace MemType, class MySolver, BkmaImpl Impl>
-inline std::enable_if_t<Impl == BkmaImpl::AdaptiveWg, sycl::event>
+inline std::enable_if_t<Impl == BkmaImpl::AdaptiveWg &&
+                            MemType == MemorySpace::Local,
+                        sycl::event>
 submit_kernels(sycl::queue &Q, span3d_t data, const MySolver &solver,
                const size_t b0_size, const size_t b0_offset,
                const size_t b2_size, const size_t b2_offset,
                const size_t orig_w0, const size_t w1, const size_t orig_w2,
                WorkGroupDispatch wg_dispatch,
+               const std::vector<sycl::event> &deps,
+               span3d_t = span3d_t{}) {
+
+    const auto n0 = data.extent(0);
+    const auto n1 = data.extent(1);
+    const auto n2 = data.extent(2);
+    const size_t window = solver.window();
+
+    auto w0 = sycl::min(orig_w0, b0_size);
+    auto w2 = sycl::min(orig_w2, b2_size);
+
+    /* The two tiles of the line passes must fit in local memory, the tile is
+    halved until they do */
+    constexpr bool passes = HasLinePasses<MySolver>::value;
+    if constexpr (passes) {
+        const auto local_mem =
+            DeviceProfile::get(Q.get_device()).local_mem_size;
+        const auto line_bytes = 2 * n1 * sizeof(real_t);
+        if (line_bytes > local_mem)
+            throw std::invalid_argument(
+                "The line passes need two lines of n1 cells in local "
+                "memory, use the global scratch");
+        while (w0 * w2 * line_bytes > local_mem) {
+            if (w0 >= w2)
+                w0 /= 2;
+            else
+                w2 /= 2;
+        }
+    }
+
+    /* The last batch can be smaller than a work-group row */
+    wg_dispatch.s0_ = sycl::min(wg_dispatch.s0_, b0_size / w0);
+    wg_dispatch.s2_ = sycl::min(wg_dispatch.s2_, b2_size / w2);
+
+    wg_dispatch.set_num_work_groups(b0_size, b2_size, 1, 1, w0, w2);
+    auto const g0 = wg_dispatch.g0_;
+    auto const g2 = wg_dispatch.g2_;
+
+    const sycl::range<3> global_size(g0 * w0, w1, g2 * w2);
+    const sycl::range<3> local_size(w0, w1, w2);
+
+    return Q.submit([&](sycl::handler &cgh) {
+        cgh.depends_on(deps);
+        MemAllocator<MemType> mallocator(sycl::range<3>(w0, n1, w2), cgh);
+        MemAllocator<MemType> pass_mallocator(
+            passes ? sycl::range<3>(w0, n1, w2) : sycl::range<3>(1, 1, 1),
+            cgh);
+
+        cgh.parallel_for(
+            sycl::nd_range<3>{global_size, local_size},
+            [=](auto itm) {
+                span3d_t tile(mallocator.get_pointer(),
+                              mallocator.get_extents());
+
+                const auto g = itm.get_group();
+                const auto i1 = itm.get_local_id(1);
+                const auto local_i0 = itm.get_local_id(0);
+                const auto local_i2 = itm.get_local_id(2);
+                /* Constant for a solver specialized on n1 */
+                const auto line_n1 = kernel_n1<MySolver>(n1);
+
+                auto line = std::experimental::submdspan(
+                    tile, local_i0, std::experimental::full_extent, local_i2);
+
+                /* Stop at the end of the batch so that concurrent batches
+                never process the same lines */
+                const auto stop_idx0 = sycl::min(n0, b0_offset + b0_size);
+                const auto stop_idx2 = sycl::min(n2, b2_offset + b2_size);
+                for (size_t tile0 = b0_offset + g.get_group_id(0) * w0;
+                     tile0 < stop_idx0; tile0 += g0 * w0) {
+                    for (size_t tile2 = b2_offset + g.get_group_id(2) * w2;
+                         tile2 < stop_idx2; tile2 += g2 * w2) {
+
+                        const auto i0 = tile0 + local_i0;
+                        const auto i2 = tile2 + local_i2;
+                        /* Ragged tiles: idle work-items still hit the
+                        barriers */
+                        const bool active = i0 < stop_idx0 && i2 < stop_idx2;
+
+                        if (active)
+                            for (size_t ii1 = i1; ii1 < line_n1;
+                                 ii1 += w1)
+                                line(ii1) = data(i0, ii1, i2);
+
+                        sycl::group_barrier(g);
+
+                        /* Each pass reads src and writes dst, the last one
+                        leaves the line to interpolate in src */
+                        auto src = line;
+                        if constexpr (passes) {
+                            span3d_t pass_tile(pass_mallocator.get_pointer(),
+                                               pass_mallocator.get_extents());
+                            auto dst = std::experimental::submdspan(
+                                pass_tile, local_i0,
+                                std::experimental::full_extent, local_i2);
+                            for (int p = 0; p < solver.line_passes(); ++p) {
+                                if (active)
+                                    for (size_t ii1 = i1; ii1 < line_n1;
+                                         ii1 += w1)
+                                        dst(ii1) = solver.line_pass(
+                                            src, p, i0, ii1, i2);
+                                sycl::group_barrier(g);
+                                std::swap(src, dst);
+                            }
+                        }
+
+                        if (active)
+                            for (size_t ii1 = i1 + window - 1;
+                                 ii1 < line_n1; ii1 += w1)
+                                data(i0, ii1 + 1 - window, i2) =
+                                    solver(src, i0, ii1, i2);
+
+                        /* The next tile overwrites the staged lines */
+                        sycl::group_barrier(g);
+                    }   // end for tile2
+                }       // end for tile0
+            }           // end lambda in parallel_for
+        );              // end parallel_for nd_range
+    });                 // end Q.submit
+}   // end submit_kernels
+
+// ==========================================
+// ==========================================
+/* Global memory path, through the global scratch. Work-groups walk the
+batch by tiles of w0 x w2 lines as in the local memory path. The line passes
+of a solver, if any, alternate between the line in data and its scratch. */
+template <MemorySpace MemType, class MySolver, BkmaImpl Impl>
+inline std::enable_if_t<Impl == BkmaImpl::AdaptiveWg &&
+                            MemType == MemorySpace::Global,
+                        sycl::event>
+submit_kernels(sycl::queue &Q, span3d_t data, const MySolver &solver,
+               const size_t b0_size, const size_t b0_offset,
+               const size_t b2_size, const size_t b2_offset,
+               const size_t orig_w0, const size_t w1, const size_t orig_w2,
+               WorkGroupDispatch wg_dispatch,
+               const std::vector<sycl::event> &deps,
                span3d_t global_scratch = span3d_t{}) {
 
     const auto w0 = sycl::min(orig_w0, b0_size);
     const auto w2 = sycl::min(orig_w2, b2_size);
 
+    /* The last batch can be smaller than a work-group row */
+    wg_dispatch.s0_ = sycl::min(wg_dispatch.s0_, b0_size / w0);
+    wg_dispatch.s2_ = sycl::min(wg_dispatch.s2_, b2_size / w2);
+
     wg_dispatch.set_num_work_groups(b0_size, b2_size, 1, 1, w0, w2);
     auto const seq_size0 = wg_dispatch.s0_;
     auto const seq_size2 = wg_dispatch.s2_;
@@ -79,19 +232,12 @@ submit_kernels(sycl::queue &Q, span3d_t data, const MySolver &solver,
     auto n1 = data.extent(1);
     auto n2 = data.extent(2);
 
-    const auto window = solver.window();
+    const size_t window = solver.window();
     const auto nw = n1 - (window-1);
 
     return Q.submit([&](sycl::handler &cgh) {
-        auto mallocator = [&]() {
-            if constexpr (MemType == MemorySpace::Local) {
-                sycl::range<3> acc_range(w0, w2, nw);
-                return MemAllocator<MemType>(acc_range, cgh);
-            } else {
-                extents_t ext(b0_size, n2, n1);
-                return MemAllocator<MemType>(global_scratch);
-            }
-        }();
+        cgh.depends_on(deps);
+        MemAllocator<MemType> mallocator(global_scratch);
 
         cgh.parallel_for(
             sycl::nd_range<3>{global_size, local_size},
@@ -99,42 +245,94 @@ submit_kernels(sycl::queue &Q, span3d_t data, const MySolver &solver,
                 span3d_t scr(mallocator.get_pointer(),
                              mallocator.get_extents());
 
+                const auto g = itm.get_group();
                 const auto i1 = itm.get_local_id(1);
-                const auto local_i0 = compute_index<MemType>(itm, 0);
-                const auto local_i2 = compute_index<MemType>(itm, 2);
+                const auto local_i0 = itm.get_local_id(0);
+                const auto local_i2 = itm.get_local_id(2);
+                /* Constant for a solver specialized on n1 */
+                const auto line_n1 = kernel_n1<MySolver>(n1);
 
                 auto scratch_slice = std::experimental::submdspan(
-                    scr, local_i0, local_i2, std::experimental::full_extent);
+                    scr, compute_index<MemType>(itm, 0),
+                    compute_index<MemType>(itm, 2),
+                    std::experimental::full_extent);
 
-                const auto start_idx0 = b0_offset + itm.get_global_id(0);
-                const auto stop_idx0 = sycl::min(n0, start_idx0 + b0_size);
-                for (size_t global_i0 = start_idx0; global_i0 < stop_idx0;
-                     global_i0 += g0 * w0) {
+                /* Stop at the end of the batch so that concurrent batches
+                never process the same lines. The loops over the tiles are
+                uniform in a work-group so that every work-item reaches the
+                barriers. */
+                const auto stop_idx0 = sycl::min(n0, b0_offset + b0_size);
+                const auto stop_idx2 = sycl::min(n2, b2_offset + b2_size);
+                for (size_t tile0 = b0_offset + g.get_group_id(0) * w0;
+                     tile0 < stop_idx0; tile0 += g0 * w0) {
+                    for (size_t tile2 = b2_offset + g.get_group_id(2) * w2;
+                         tile2 < stop_idx2; tile2 += g2 * w2) {
 
-                    const auto start_idx2 = b2_offset + itm.get_global_id(2);
-                    const auto stop_idx2 = sycl::min(n2, start_idx2 + b2_size);
-                    for (size_t global_i2 = start_idx2; global_i2 < stop_idx2;
-                         global_i2 += g2 * w2) {
+                        const auto global_i0 = tile0 + local_i0;
+                        const auto global_i2 = tile2 + local_i2;
+                        /* Ragged tiles: idle work-items still hit the
+                        barriers */
+                        const bool active =
+                            global_i0 < stop_idx0 && global_i2 < stop_idx2;
 
                         auto data_slice = std::experimental::submdspan(
-                            data, global_i0, std::experimental::full_extent,
-                            global_i2);
-
-                        for (int ii1 = i1; ii1 < n1; ii1 += w1) {
-                            auto const iw = ii1 - (window - 1);
-                            if(iw >= 0)
-                                scratch_slice(iw) = solver(
-                                    data_slice, global_i0, ii1, global_i2);
+                            data, active ? global_i0 : 0,
+                            std::experimental::full_extent,
+                            active ? global_i2 : 0);
+
+                        /* The line passes alternate between the line and its
+                        scratch, one launch for lines too long for the local
+                        memory. After an odd number of passes the line to
+                        interpolate is in the scratch and the results go
+                        straight to data. */
+                        int n_passes = 0;
+                        if constexpr (HasLinePasses<MySolver>::value) {
+                            auto pass = [&](auto src, auto dst, const int p) {
+                                if (active)
+                                    for (size_t ii1 = i1; ii1 < line_n1;
+                                         ii1 += w1)
+                                        dst(ii1) = solver.line_pass(
+                                            src, p, global_i0, ii1, global_i2);
+                                sycl::group_barrier(g);
+                            };
+                            n_passes = solver.line_passes();
+                            for (int p = 0; p < n_passes; ++p) {
+                                if (p % 2 == 0)
+                                    pass(data_slice, scratch_slice, p);
+                                else
+                                    pass(scratch_slice, data_slice, p);
+                            }
                         }
 
-                        sycl::group_barrier(itm.get_group());
+                        if (n_passes % 2 == 1) {
+                            if (active)
+                                for (size_t ii1 = i1; ii1 < line_n1; ii1 += w1)
+                                    data_slice(ii1) = solver(
+                                        scratch_slice, global_i0, ii1,
+                                        global_i2);
+                        } else {
+                            /* 64-bit cell indices, n1 may exceed INT_MAX */
+                            if (active)
+                                for (size_t ii1 = i1; ii1 < line_n1;
+                                     ii1 += w1) {
+                                    if (ii1 + 1 >= window)
+                                        scratch_slice(ii1 + 1 - window) =
+                                            solver(data_slice, global_i0, ii1,
+                                                   global_i2);
+                                }
 
-                        for (int iw = i1; iw < nw; iw += w1) {
-                            data_slice(iw) = scratch_slice(iw);
+                            sycl::group_barrier(g);
+
+                            if (active)
+                                for (size_t iw = i1; iw < nw; iw += w1)
+                                    data_slice(iw) = scratch_slice(iw);
                         }
-                    }   // end for ii2
-                }   // end for ii0
-            }       // end lambda in parallel_for
-        );          // end parallel_for nd_range
-    });      // end Q.submit
+
+                        /* The next tile overwrites the scratch */
+                        sycl::group_barrier(g);
+                    }   // end for tile2
+                }       // end for tile0
+            }           // end lambda in parallel_for
+        );              // end parallel_for nd_range
+    });                 // end Q.submit
 }   // end submit_kernels
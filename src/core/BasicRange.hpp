@@ -24,46 +24,48 @@
 //                              const AdvectionSolver &solver) override;
 //   };
 
+/* Out of place: a first kernel writes the nw updated cells of every line of
+the batch to the global scratch (b0_size x b2_size x nw), a second one
+copies them back. Work-group sizes are left to the runtime. */
 template <MemorySpace MemType, class MySolver, BkmaImpl Impl>
 inline std::enable_if_t<Impl == BkmaImpl::BasicRange, sycl::event>
 submit_kernels(sycl::queue &Q, span3d_t data, const MySolver &solver,
                const size_t b0_size, const size_t b0_offset,
                const size_t b2_size, const size_t b2_offset,
                const size_t orig_w0, const size_t w1, const size_t orig_w2,
-               WorkGroupDispatch wg_dispatch, span3d_t global_scratch) {
+               WorkGroupDispatch wg_dispatch,
+               const std::vector<sycl::event> &deps, span3d_t global_scratch) {
 
     static_assert(
         !(MemType == MemorySpace::Local && BkmaImpl::BasicRange == Impl),
         "BasicRange is not supported with MemorySpace::Local");
 
-    auto n0 = data.extent(0);
-    auto n1 = data.extent(1);
-    auto n2 = data.extent(2);
+    const auto n1 = data.extent(1);
+    const auto window = solver.window();
+    const auto nw = n1 - (window - 1);
 
-    sycl::range r3d(n0, n1, n2);
+    sycl::range r3d(b0_size, nw, b2_size);
 
-    Q.submit([&](sycl::handler &cgh) {
+    auto solve = Q.submit([&](sycl::handler &cgh) {
+        cgh.depends_on(deps);
         cgh.parallel_for(r3d, [=](sycl::id<3> itm) {
-            const int i1 = itm[1];
-            const int i0 = itm[0];
-            const int i2 = itm[2];
+            const auto i0 = b0_offset + itm[0];
+            const auto iw = itm[1];
+            const auto i2 = b2_offset + itm[2];
 
-            global_scratch(i0, i1, i2) =
+            global_scratch(itm[0], itm[2], iw) =
                 solver(std::experimental::submdspan(
                            data, i0, std::experimental::full_extent, i2),
-                       i0, i1, i2);
-            // barrier
+                       i0, iw + (window - 1), i2);
         });   // end parallel_for
     });       // end Q.submit
-    Q.wait();
-    // copy
+
     return Q.submit([&](sycl::handler &cgh) {
+        cgh.depends_on(solve);
         cgh.parallel_for(r3d, [=](sycl::id<3> itm) {
-            const int i1 = itm[1];
-            const int i0 = itm[0];
-            const int i2 = itm[2];
-            data(i0, i1, i2) = global_scratch(i0, i1, i2);
-            // barrier
+            const auto iw = itm[1];
+            data(b0_offset + itm[0], iw, b2_offset + itm[2]) =
+                global_scratch(itm[0], itm[2], iw);
         });   // end parallel_for
     });       // end Q.submit
-}
+}   // end submit_kernels
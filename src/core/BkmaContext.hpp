@@ -0,0 +1,99 @@
+#pragma once
+#include <stdexcept>
+#include <bkma_tools.hpp>
+#include <MemorySpace.hpp>
+#include <types.hpp>
+#include <sycl/sycl.hpp>
+
+// ==========================================
+// ==========================================
+/* Owns the global scratch used by the Global and Hybrid memory spaces. The
+pool is sized for one batch (lines of the batch x nw), grows only when a
+larger batch is requested and is reused across calls and time steps. The
+pool can also back other device buffers through pool(), a context per buffer.
+A context is not thread-safe: use one per host thread running bkma_run. */
+class BkmaContext {
+    sycl::queue q_;
+    real_t *pool_ = nullptr;
+    size_t capacity_ = 0;   // number of real_t in the pool
+    size_t *counters_ = nullptr;
+
+  public:
+    BkmaContext() = delete;
+    BkmaContext(const BkmaContext &) = delete;
+    BkmaContext &operator=(const BkmaContext &) = delete;
+
+    explicit BkmaContext(sycl::queue q) : q_(q) {}
+
+    ~BkmaContext() {
+        if (pool_ != nullptr)
+            sycl::free(pool_, q_);
+        if (counters_ != nullptr)
+            sycl::free(counters_, q_);
+    }
+
+    [[nodiscard]] inline sycl::queue &queue() { return q_; }
+
+    [[nodiscard]] inline size_t capacity_bytes() const {
+        return capacity_ * sizeof(real_t);
+    }
+
+    // ==========================================
+    /* Number of lines of a batch that go through the global scratch */
+    [[nodiscard]] static size_t
+    global_lines0(const BkmaOptimParams &optim_params) {
+        const auto b0 = optim_params.dispatch_d0.batch_size_;
+        switch (optim_params.mem_space) {
+        case MemorySpace::Local:
+            return 0;
+        case MemorySpace::Hybrid: {
+            auto kd = dispatch_kernels(b0, optim_params.percent_loc);
+            return b0 - (kd.k_local_ - kd.k_local_ % optim_params.w0);
+        }
+        default:
+            return b0;
+        }
+    }
+
+    // ==========================================
+    /* At least size real_t of device memory. Reallocates only when the pool
+    is too small, the previous content is then lost. */
+    [[nodiscard]] real_t *pool(const size_t size) {
+        if (size > capacity_) {
+            q_.wait();
+            if (pool_ != nullptr)
+                sycl::free(pool_, q_);
+            capacity_ = 0;
+            pool_ = sycl_alloc(size, q_);
+            if (pool_ == nullptr)
+                throw std::runtime_error("Failed to allocate the pool");
+            capacity_ = size;
+            q_.wait();
+        }
+        return pool_;
+    }
+
+    // ==========================================
+    /* Global scratch for one batch of optim_params, an empty span when only
+    local scratch is used. Reallocates only when the pool is too small. */
+    [[nodiscard]] span3d_t scratch(const BkmaOptimParams &optim_params,
+                                   const size_t nw) {
+        const auto b0 = global_lines0(optim_params);
+        const auto b2 = optim_params.dispatch_d2.batch_size_;
+        if (b0 == 0)
+            return span3d_t{};
+
+        return span3d_t(pool(b0 * b2 * nw), b0, b2, nw);
+    }
+
+    // ==========================================
+    /* Work counters of the Persistent implementation, zeroed once, the
+    kernel resets them when it completes */
+    [[nodiscard]] size_t *work_counters() {
+        if (counters_ == nullptr) {
+            counters_ = sycl::malloc_device<size_t>(2, q_);
+            q_.memset(counters_, 0, 2 * sizeof(size_t)).wait();
+        }
+        return counters_;
+    }
+};   // end class BkmaContext
@@ -0,0 +1,112 @@
+#pragma once
+#include <array>
+#include <climits>
+#include <limits>
+#include <list>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include <types.hpp>
+#include <sycl/sycl.hpp>
+
+// ==========================================
+// ==========================================
+/* Everything the planners need to know about a device, queried once per
+device with DeviceProfile::get. When the SYCL implementation cannot be
+queried for the number of work-groups, the backend limits are used:
+           |    x    |   y/z   |
+      CUDA:| 2**31-1 | 2**16-1 |
+      HIP :| 2**32-1 | 2**32-1 |
+      L0  :| 2**32-1 | 2**32-1 | (compile with -fno-sycl-query-fit-in-int)
+      CPU :        a lot
+SYCL dim 2 is mapped on x, dims 0 and 1 on z and y. */
+struct DeviceProfile {
+    std::string name;
+    std::string vendor;
+    bool is_gpu;
+
+    /* Work-groups */
+    size_t local_mem_size;   // bytes per work-group, 0 without local memory
+    size_t max_wg_size;
+    std::array<size_t, 3> max_wi_sizes;   // per nd_range dimension
+    std::vector<size_t> sub_group_sizes;
+    size_t compute_units;
+
+    /* Global memory */
+    size_t global_mem_size;
+    size_t global_mem_cache_size;
+    size_t global_mem_cache_line;
+    size_t max_alloc_elems;   // largest single allocation of real_t
+
+    /* Index limits */
+    std::array<size_t, 3> max_work_groups;   // per nd_range dimension
+    size_t max_global_range;   // largest global range in one dimension
+
+    // ==========================================
+    [[nodiscard]] static DeviceProfile query(const sycl::device &d) {
+        using namespace sycl::info;
+        DeviceProfile p;
+        constexpr auto unlimited = std::numeric_limits<size_t>::max();
+
+        p.name = d.get_info<device::name>();
+        p.vendor = d.get_info<device::vendor>();
+        p.is_gpu = d.is_gpu();
+
+        /* A device without dedicated local memory is treated as having none */
+        p.local_mem_size = d.get_info<device::local_mem_type>() ==
+                                   local_mem_type::none
+                               ? 0
+                               : d.get_info<device::local_mem_size>();
+        p.max_wg_size = d.get_info<device::max_work_group_size>();
+        auto wi_sizes = d.get_info<device::max_work_item_sizes<3>>();
+        p.max_wi_sizes = {wi_sizes[0], wi_sizes[1], wi_sizes[2]};
+        p.sub_group_sizes = d.get_info<device::sub_group_sizes>();
+        p.compute_units = d.get_info<device::max_compute_units>();
+
+        p.global_mem_size = d.get_info<device::global_mem_size>();
+        p.global_mem_cache_size = d.get_info<device::global_mem_cache_size>();
+        p.global_mem_cache_line =
+            d.get_info<device::global_mem_cache_line_size>();
+        p.max_alloc_elems =
+            d.get_info<device::max_mem_alloc_size>() / sizeof(real_t);
+
+#ifdef SYCL_EXT_ONEAPI_MAX_WORK_GROUP_QUERY
+        namespace syclex = sycl::ext::oneapi::experimental;
+        auto max_wg = d.get_info<syclex::info::device::max_work_groups<3>>();
+        p.max_work_groups = {max_wg[0], max_wg[1], max_wg[2]};
+#else
+        if (d.is_cpu())
+            p.max_work_groups = {unlimited, unlimited, unlimited};
+        else if (p.vendor.find("NVIDIA") != std::string::npos)
+            p.max_work_groups = {(1ul << 16) - 1, (1ul << 16) - 1,
+                                 (1ul << 31) - 1};
+        else
+            p.max_work_groups = {(1ul << 32) - 1, (1ul << 32) - 1,
+                                 (1ul << 32) - 1};
+#endif
+
+#ifdef __SYCL_ID_QUERIES_FIT_IN_INT__
+        p.max_global_range = INT_MAX;
+#else
+        p.max_global_range = unlimited;
+#endif
+        return p;
+    }
+
+    // ==========================================
+    /* Profile of d, queried on the first call only. Safe to call from
+    several threads. */
+    [[nodiscard]] static const DeviceProfile &get(const sycl::device &d) {
+        static std::mutex mutex;
+        static std::list<std::pair<sycl::device, DeviceProfile>> cache;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto &[device, profile] : cache)
+            if (device == d)
+                return profile;
+
+        cache.emplace_back(d, query(d));
+        return cache.back().second;
+    }
+};   // end struct DeviceProfile
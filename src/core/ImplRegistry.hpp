@@ -0,0 +1,163 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <string>
+#include <type_traits>
+#include <bkma_tools.hpp>
+#include <DeviceProfile.hpp>
+#include <MemorySpace.hpp>
+
+// ==========================================
+// ==========================================
+/* Capabilities and constraints of an implementation, one specialization per
+BkmaImpl. bkma_run only instantiates the memory spaces an implementation
+supports, impl_unsupported tells the driver which ones apply to a problem. */
+template <BkmaImpl Impl> struct ImplTraits;
+
+/* Out of place through a global buffer, one work-item per cell */
+template <> struct ImplTraits<BkmaImpl::BasicRange> {
+    static constexpr auto name = "BasicRange";
+    static constexpr bool local_scratch = false;
+    static constexpr bool global_scratch = true;
+    static constexpr bool in_place = false;
+    static constexpr bool any_window = true;
+    static constexpr bool work_counters = false;
+
+    [[nodiscard]] static size_t local_bytes(const BkmaOptimParams &,
+                                            const size_t, const size_t) {
+        return 0;
+    }
+    [[nodiscard]] static size_t max_n1(const DeviceProfile &dev) {
+        return dev.max_global_range;
+    }
+};
+
+/* One work-group per line, the whole line in local memory. The line is
+written back entirely, the solver window must be 1. */
+template <> struct ImplTraits<BkmaImpl::NDRange> {
+    static constexpr auto name = "NDRange";
+    static constexpr bool local_scratch = true;
+    static constexpr bool global_scratch = false;
+    static constexpr bool in_place = true;
+    static constexpr bool any_window = false;
+    static constexpr bool work_counters = false;
+
+    [[nodiscard]] static size_t local_bytes(const BkmaOptimParams &,
+                                            const size_t,
+                                            const size_t nw) {
+        return nw * sizeof(real_t);
+    }
+    [[nodiscard]] static size_t max_n1(const DeviceProfile &dev) {
+        return std::min(dev.max_wg_size, dev.max_wi_sizes[1]);
+    }
+};
+
+/* With local memory, the w0 x w2 lines of a work-group are staged whole */
+template <> struct ImplTraits<BkmaImpl::AdaptiveWg> {
+    static constexpr auto name = "AdaptiveWg";
+    static constexpr bool local_scratch = true;
+    static constexpr bool global_scratch = true;
+    static constexpr bool in_place = true;
+    static constexpr bool any_window = true;
+    static constexpr bool work_counters = false;
+
+    [[nodiscard]] static size_t local_bytes(const BkmaOptimParams &p,
+                                            const size_t n1, const size_t) {
+        return p.mem_space == MemorySpace::Global
+                   ? 0
+                   : p.w0 * p.w2 * n1 * sizeof(real_t);
+    }
+    [[nodiscard]] static size_t max_n1(const DeviceProfile &dev) {
+        return dev.max_global_range;
+    }
+};
+
+template <> struct ImplTraits<BkmaImpl::Persistent> {
+    static constexpr auto name = "Persistent";
+    static constexpr bool local_scratch = true;
+    static constexpr bool global_scratch = false;
+    static constexpr bool in_place = true;
+    static constexpr bool any_window = true;
+    static constexpr bool work_counters = true;
+
+    [[nodiscard]] static size_t local_bytes(const BkmaOptimParams &p,
+                                            const size_t,
+                                            const size_t nw) {
+        return p.w0 * p.w2 * nw * sizeof(real_t);
+    }
+    [[nodiscard]] static size_t max_n1(const DeviceProfile &dev) {
+        return dev.max_global_range;
+    }
+};
+
+// ==========================================
+// ==========================================
+/* Every implementation, in the order the automatic selection tries them */
+static constexpr std::array<BkmaImpl, 4> ALL_IMPLS = {
+    BkmaImpl::AdaptiveWg, BkmaImpl::Persistent, BkmaImpl::NDRange,
+    BkmaImpl::BasicRange};
+
+// ==========================================
+// ==========================================
+/* Calls f(std::integral_constant<BkmaImpl, impl>{}), so that f can
+instantiate bkma_run for impl without type erasure on the call */
+template <class F>
+inline decltype(auto)
+visit_impl(const BkmaImpl impl, F &&f) {
+    using std::integral_constant;
+    switch (impl) {
+    case BkmaImpl::BasicRange:
+        return f(integral_constant<BkmaImpl, BkmaImpl::BasicRange>{});
+    case BkmaImpl::NDRange:
+        return f(integral_constant<BkmaImpl, BkmaImpl::NDRange>{});
+    case BkmaImpl::AdaptiveWg:
+        return f(integral_constant<BkmaImpl, BkmaImpl::AdaptiveWg>{});
+    default:
+        return f(integral_constant<BkmaImpl, BkmaImpl::Persistent>{});
+    }
+}   // end visit_impl
+
+// ==========================================
+// ==========================================
+[[nodiscard]] inline std::string
+impl_to_string(const BkmaImpl impl) {
+    return visit_impl(impl, [](auto I) -> std::string {
+        return ImplTraits<decltype(I)::value>::name;
+    });
+}
+
+// ==========================================
+// ==========================================
+/* Why impl cannot run optim_params on lines of n1 cells updated by a solver
+of the given window, with line passes or not, on dev, or an empty string if
+it can */
+[[nodiscard]] inline std::string
+impl_unsupported(const BkmaImpl impl, const DeviceProfile &dev,
+                 const BkmaOptimParams &optim_params, const size_t n1,
+                 const size_t window, const bool line_passes = false) {
+    return visit_impl(impl, [&](auto I) -> std::string {
+        using Traits = ImplTraits<decltype(I)::value>;
+        const auto nw = n1 - (window - 1);
+        const auto mem_space = optim_params.mem_space;
+
+        if (mem_space != MemorySpace::Global && !Traits::local_scratch)
+            return std::string(Traits::name) + " needs the global scratch";
+        if (mem_space != MemorySpace::Local && !Traits::global_scratch)
+            return std::string(Traits::name) + " needs the local scratch";
+        if (window != 1 && !Traits::any_window)
+            return std::string(Traits::name) + " needs a solver window of 1";
+        if (line_passes && decltype(I)::value != BkmaImpl::AdaptiveWg)
+            return std::string(Traits::name) + " does not run line passes";
+        if (n1 > Traits::max_n1(dev))
+            return std::string(Traits::name) + " supports n1 up to " +
+                   std::to_string(Traits::max_n1(dev));
+        /* The line passes alternate between two tiles of the lines */
+        const auto local_bytes = Traits::local_bytes(
+            optim_params, line_passes ? 2 * n1 : n1, nw);
+        if (local_bytes > dev.local_mem_size)
+            return std::string(Traits::name) + " needs " +
+                   std::to_string(local_bytes) +
+                   " B of local memory per work-group";
+        return {};
+    });
+}   // end impl_unsupported
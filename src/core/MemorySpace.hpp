@@ -1,5 +1,8 @@
 #pragma once
+#include <stdexcept>
+#include <string>
 #include <sycl/sycl.hpp>
+#include <types.hpp>
 
 #ifdef SYCL_IMPLEMENTATION_ONEAPI
 #define GET_POINTER get_multi_ptr<sycl::access::decorated::no>().get
@@ -9,7 +12,31 @@
 
 //==============================================================================
 //==============================================================================
-enum class MemorySpace { Local, Global };
+/* Hybrid splits the lines of a batch between Local and Global kernels */
+enum class MemorySpace { Local, Global, Hybrid };
+
+[[nodiscard]] inline std::string
+mem_space_to_string(const MemorySpace mem_space) {
+    switch (mem_space) {
+    case MemorySpace::Local:
+        return "local";
+    case MemorySpace::Global:
+        return "global";
+    default:
+        return "hybrid";
+    }
+}
+
+[[nodiscard]] inline MemorySpace
+mem_space_from_string(const std::string &str) {
+    if (str == "local")
+        return MemorySpace::Local;
+    if (str == "global")
+        return MemorySpace::Global;
+    if (str == "hybrid")
+        return MemorySpace::Hybrid;
+    throw std::invalid_argument(str + " is not a valid MemorySpace");
+}
 
 template <MemorySpace MemType> struct MemAllocator;
 
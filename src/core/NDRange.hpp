@@ -8,23 +8,24 @@ submit_kernels(sycl::queue &Q, span3d_t data, const MySolver &solver,
                const size_t b2_size, const size_t b2_offset,
                const size_t orig_w0, const size_t w1, const size_t orig_w2,
                WorkGroupDispatch wg_dispatch,
+               const std::vector<sycl::event> &deps,
                span3d_t global_scratch = span3d_t{}) {
 
-    const auto n0 = data.extent(0);
     const auto n1 = data.extent(1);
-    const auto n2 = data.extent(2);
 
-    const sycl::range global_size{n0, n1, n2};
+    /* One work-group per line of the batch */
+    const sycl::range global_size{b0_size, n1, b2_size};
     const sycl::range local_size{1, n1, 1};
 
     return Q.submit([&](sycl::handler &cgh) {
+        cgh.depends_on(deps);
         sycl::local_accessor<real_t, 1> slice_ftmp(sycl::range<1>(n1), cgh);
 
         cgh.parallel_for(sycl::nd_range<3>{global_size, local_size},
                          [=](auto itm) {
-                             const int i1 = itm.get_local_id(1);
-                             const int i0 = itm.get_global_id(0);
-                             const int i2 = itm.get_global_id(2);
+                             const size_t i1 = itm.get_local_id(1);
+                             const size_t i0 = b0_offset + itm.get_global_id(0);
+                             const size_t i2 = b2_offset + itm.get_global_id(2);
 
                              auto slice = std::experimental::submdspan(
                                  data, i0, std::experimental::full_extent, i2);
@@ -0,0 +1,126 @@
+#pragma once
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+#include <bkma_tools.hpp>
+#include <DeviceProfile.hpp>
+#include <MemorySpace.hpp>
+
+// ==========================================
+// ==========================================
+/* Persistent kernel: a single launch of as many work-groups as the device
+keeps resident, each one pulling tiles of w0 x w2 lines from a device-wide
+counter until all the lines are processed. Lines of uneven cost and ragged
+ends balance themselves, and no batching is needed since the grid size no
+longer depends on n0 and n2. The last work-group to run out of tiles resets
+the counters for the next launch. Only the local scratch is supported. */
+template <class MySolver>
+inline sycl::event
+submit_persistent(sycl::queue &Q, span3d_t data, const MySolver &solver,
+                  const BkmaOptimParams &optim_params,
+                  const std::vector<sycl::event> &deps) {
+    if (optim_params.mem_space != MemorySpace::Local)
+        throw std::invalid_argument(
+            "The Persistent kernel only supports the local scratch");
+    if (optim_params.work_counters == nullptr)
+        throw std::invalid_argument(
+            "The Persistent kernel needs work_counters, see BkmaContext");
+
+    const auto n0 = data.extent(0);
+    const auto n1 = data.extent(1);
+    const auto n2 = data.extent(2);
+    const size_t window = solver.window();
+    const auto nw = n1 - (window - 1);
+
+    const auto w0 = std::min(optim_params.w0, n0);
+    const auto w1 = optim_params.w1;
+    const auto w2 = std::min(optim_params.w2, n2);
+
+    const auto n_tiles2 = (n2 + w2 - 1) / w2;
+    const auto n_tiles = (n0 + w0 - 1) / w0 * n_tiles2;
+
+    /* One wave of resident work-groups */
+    const auto &dev = DeviceProfile::get(Q.get_device());
+    const auto wg_size = w0 * w1 * w2;
+    const auto local_bytes = w0 * w2 * nw * sizeof(real_t);
+    const auto resident = std::max<size_t>(
+        1, std::min(2 * dev.max_wg_size / wg_size,
+                    local_bytes > 0 ? dev.local_mem_size / local_bytes : 1));
+    const auto n_wg = std::min(n_tiles, dev.compute_units * resident);
+
+    const sycl::range<3> global_size(n_wg * w0, w1, w2);
+    const sycl::range<3> local_size(w0, w1, w2);
+    auto counters = optim_params.work_counters;
+
+    return Q.submit([&](sycl::handler &cgh) {
+        cgh.depends_on(deps);
+        MemAllocator<MemorySpace::Local> mallocator(sycl::range<3>(w0, w2, nw),
+                                                    cgh);
+
+        cgh.parallel_for(
+            sycl::nd_range<3>{global_size, local_size}, [=](auto itm) {
+                /* finished publishes the last fetch on next_tile of each
+                work-group before the reset */
+                sycl::atomic_ref<size_t, sycl::memory_order::relaxed,
+                                 sycl::memory_scope::device,
+                                 sycl::access::address_space::global_space>
+                    next_tile(counters[0]);
+                sycl::atomic_ref<size_t, sycl::memory_order::acq_rel,
+                                 sycl::memory_scope::device,
+                                 sycl::access::address_space::global_space>
+                    finished(counters[1]);
+
+                const auto g = itm.get_group();
+                const bool leader = itm.get_local_linear_id() == 0;
+                const auto i1 = itm.get_local_id(1);
+                const auto local_i0 = itm.get_local_id(0);
+                const auto local_i2 = itm.get_local_id(2);
+                /* Constant for a solver specialized on n1 */
+                const auto line_n1 = kernel_n1<MySolver>(n1);
+
+                span3d_t scr(mallocator.get_pointer(),
+                             mallocator.get_extents());
+                auto scratch_slice = std::experimental::submdspan(
+                    scr, local_i0, local_i2, std::experimental::full_extent);
+
+                while (true) {
+                    size_t tile = 0;
+                    if (leader)
+                        tile = next_tile.fetch_add(size_t{1});
+                    tile = sycl::group_broadcast(g, tile);
+                    if (tile >= n_tiles)
+                        break;
+
+                    const auto i0 = tile / n_tiles2 * w0 + local_i0;
+                    const auto i2 = tile % n_tiles2 * w2 + local_i2;
+                    /* Ragged tiles: idle work-items still hit the barriers */
+                    const bool active = i0 < n0 && i2 < n2;
+
+                    auto data_slice = std::experimental::submdspan(
+                        data, active ? i0 : 0, std::experimental::full_extent,
+                        active ? i2 : 0);
+
+                    if (active)
+                        for (size_t ii1 = i1; ii1 < line_n1; ii1 += w1) {
+                            if (ii1 + 1 >= window)
+                                scratch_slice(ii1 + 1 - window) =
+                                    solver(data_slice, i0, ii1, i2);
+                        }
+
+                    sycl::group_barrier(g);
+
+                    if (active)
+                        for (size_t iw = i1; iw < nw; iw += w1)
+                            data_slice(iw) = scratch_slice(iw);
+
+                    sycl::group_barrier(g);
+                }   // end while tiles
+
+                if (leader && finished.fetch_add(size_t{1}) == n_wg - 1) {
+                    next_tile.store(0);
+                    finished.store(0);
+                }
+            }   // end lambda in parallel_for
+        );      // end parallel_for nd_range
+    });         // end Q.submit
+}   // end submit_persistent
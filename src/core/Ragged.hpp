@@ -0,0 +1,231 @@
+#pragma once
+#include <algorithm>
+#include <functional>
+#include <numeric>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <bkma_tools.hpp>
+#include <DeviceProfile.hpp>
+#include <types.hpp>
+#include <sycl/sycl.hpp>
+
+// ==========================================
+// ==========================================
+/* Lines of a ragged batch grouped in tiles, one tile per work-group. Tile t
+holds lines[offsets[t]] to lines[offsets[t+1] - 1]. */
+struct LineTiles {
+    std::vector<size_t> offsets;
+    std::vector<size_t> lines;
+};
+
+/* Longest lines first, each one to the tile with the least cells so far, so
+that work-groups get about the same number of cells */
+[[nodiscard]] inline LineTiles
+balance_lines(const std::vector<size_t> &lengths, const size_t n_tiles) {
+    std::vector<size_t> order(lengths.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return lengths[a] > lengths[b];
+    });
+
+    using Load = std::pair<size_t, size_t>;   // cells, tile
+    std::priority_queue<Load, std::vector<Load>, std::greater<Load>> loads;
+    for (size_t t = 0; t < n_tiles; ++t)
+        loads.push({0, t});
+
+    std::vector<std::vector<size_t>> tiles(n_tiles);
+    for (auto line : order) {
+        auto [cells, t] = loads.top();
+        loads.pop();
+        tiles[t].push_back(line);
+        loads.push({cells + lengths[line], t});
+    }
+
+    LineTiles result;
+    result.offsets.push_back(0);
+    for (const auto &tile : tiles) {
+        result.lines.insert(result.lines.end(), tile.begin(), tile.end());
+        result.offsets.push_back(result.lines.size());
+    }
+    return result;
+}   // end balance_lines
+
+// ==========================================
+// ==========================================
+/* Lines of different lengths packed one after the other: line r holds the
+cells offsets[r] to offsets[r+1] - 1 of the data buffer. Owns the device
+tables of the offsets and of the balanced tiles, and the global scratch
+used when the longest line does not fit in local memory. */
+class RaggedBatch {
+    sycl::queue q_;
+    std::vector<size_t> offsets_;   // host copy, n_lines + 1
+    size_t max_n1_ = 0;
+    size_t w1_;
+    size_t n_tiles_;
+    bool local_;
+
+    size_t *offsets_dev_ = nullptr;
+    size_t *tile_offsets_ = nullptr;
+    size_t *tile_lines_ = nullptr;
+    real_t *scratch_ = nullptr;
+
+  public:
+    RaggedBatch() = delete;
+    RaggedBatch(const RaggedBatch &) = delete;
+    RaggedBatch &operator=(const RaggedBatch &) = delete;
+
+    /* w1 work-items update a line, one work-group per tile */
+    RaggedBatch(sycl::queue q, const std::vector<size_t> &lengths,
+                const size_t w1)
+        : q_(q) {
+        if (lengths.empty())
+            throw std::invalid_argument("RaggedBatch needs a line");
+
+        offsets_.assign(1, 0);
+        for (auto l : lengths) {
+            if (l == 0)
+                throw std::invalid_argument("Ragged lines can't be empty");
+            offsets_.push_back(offsets_.back() + l);
+            max_n1_ = std::max(max_n1_, l);
+        }
+
+        /* One wave of resident work-groups, as the Persistent kernel */
+        const auto &dev = DeviceProfile::get(q_.get_device());
+        w1_ = std::max<size_t>(1, std::min({w1, dev.max_wg_size, max_n1_}));
+        local_ = max_n1_ * sizeof(real_t) <= dev.local_mem_size;
+        const auto resident = std::max<size_t>(
+            1, std::min(2 * dev.max_wg_size / w1_,
+                        local_ ? dev.local_mem_size /
+                                     (max_n1_ * sizeof(real_t))
+                               : 1));
+        n_tiles_ = std::min(lengths.size(), dev.compute_units * resident);
+
+        const auto tiles = balance_lines(lengths, n_tiles_);
+
+        offsets_dev_ = sycl::malloc_device<size_t>(offsets_.size(), q_);
+        tile_offsets_ = sycl::malloc_device<size_t>(n_tiles_ + 1, q_);
+        tile_lines_ = sycl::malloc_device<size_t>(lengths.size(), q_);
+        if (!local_)
+            scratch_ = sycl_alloc(size(), q_);
+        if (!offsets_dev_ || !tile_offsets_ || !tile_lines_ ||
+            (!local_ && !scratch_))
+            throw std::runtime_error("Failed to allocate the ragged batch");
+
+        q_.copy(offsets_.data(), offsets_dev_, offsets_.size());
+        q_.copy(tiles.offsets.data(), tile_offsets_, n_tiles_ + 1);
+        q_.copy(tiles.lines.data(), tile_lines_, lengths.size());
+        q_.wait();
+    }
+
+    ~RaggedBatch() {
+        sycl::free(offsets_dev_, q_);
+        sycl::free(tile_offsets_, q_);
+        sycl::free(tile_lines_, q_);
+        if (scratch_ != nullptr)
+            sycl::free(scratch_, q_);
+    }
+
+    [[nodiscard]] inline size_t n_lines() const {
+        return offsets_.size() - 1;
+    }
+    /* Number of cells of the packed buffer */
+    [[nodiscard]] inline size_t size() const { return offsets_.back(); }
+    [[nodiscard]] inline size_t offset(const size_t r) const {
+        return offsets_[r];
+    }
+    [[nodiscard]] inline size_t length(const size_t r) const {
+        return offsets_[r + 1] - offsets_[r];
+    }
+    [[nodiscard]] inline size_t max_length() const { return max_n1_; }
+    [[nodiscard]] inline size_t n_tiles() const { return n_tiles_; }
+    [[nodiscard]] inline size_t w1() const { return w1_; }
+    [[nodiscard]] inline bool local_scratch() const { return local_; }
+
+    [[nodiscard]] inline const size_t *offsets_dev() const {
+        return offsets_dev_;
+    }
+    [[nodiscard]] inline const size_t *tile_offsets() const {
+        return tile_offsets_;
+    }
+    [[nodiscard]] inline const size_t *tile_lines() const {
+        return tile_lines_;
+    }
+    [[nodiscard]] inline real_t *scratch() const { return scratch_; }
+};   // end class RaggedBatch
+
+// ==========================================
+// ==========================================
+/* Updates every line of a packed ragged buffer once. Each work-group walks
+the lines of its tile, sizing the loops and the scratch of each line from
+its length; the scratch is local when the longest line fits, else the
+packed global scratch of the batch. The solver of a line of n1 cells is
+solver.for_line(n1), it is called with i0 the index of the line, and
+solver.valid_length(n1) rejects the lengths it cannot update. */
+template <class MySolver>
+inline sycl::event
+submit_ragged(sycl::queue &Q, const RaggedBatch &batch, real_t *data,
+              const MySolver &solver,
+              const std::vector<sycl::event> &deps = {}) {
+    const auto window = solver.window();
+    for (size_t r = 0; r < batch.n_lines(); ++r) {
+        if (batch.length(r) < window)
+            throw std::invalid_argument("Ragged line " + std::to_string(r) +
+                                        " is shorter than the solver window");
+        if (!solver.valid_length(batch.length(r)))
+            throw std::invalid_argument(
+                "Ragged line " + std::to_string(r) + " has a length of " +
+                std::to_string(batch.length(r)) +
+                " cells, not supported by the solver");
+    }
+
+    const auto w1 = batch.w1();
+    const auto n_tiles = batch.n_tiles();
+    const auto local = batch.local_scratch();
+    const auto local_size = local ? batch.max_length() - (window - 1) : 1;
+
+    const auto offsets = batch.offsets_dev();
+    const auto tile_offsets = batch.tile_offsets();
+    const auto tile_lines = batch.tile_lines();
+    const auto global_scratch = batch.scratch();
+
+    return Q.submit([&](sycl::handler &cgh) {
+        cgh.depends_on(deps);
+        sycl::local_accessor<real_t, 1> local_scratch(
+            sycl::range<1>(local_size), cgh);
+
+        cgh.parallel_for(
+            sycl::nd_range<1>{n_tiles * w1, w1}, [=](sycl::nd_item<1> itm) {
+                const auto g = itm.get_group();
+                const auto tile = itm.get_group_linear_id();
+                const auto i1 = itm.get_local_id(0);
+
+                for (auto t = tile_offsets[tile]; t < tile_offsets[tile + 1];
+                     ++t) {
+                    const auto r = tile_lines[t];
+                    const auto start = offsets[r];
+                    const auto n1 = offsets[r + 1] - start;
+                    const auto nw = n1 - (window - 1);
+
+                    span1d_t line(data + start, n1);
+                    real_t *scr = local ? &local_scratch[0]
+                                        : global_scratch + start;
+                    const auto line_solver = solver.for_line(n1);
+
+                    for (size_t ii1 = i1 + window - 1; ii1 < n1; ii1 += w1)
+                        scr[ii1 - (window - 1)] =
+                            line_solver(line, r, ii1, 0);
+
+                    sycl::group_barrier(g);
+
+                    for (size_t iw = i1; iw < nw; iw += w1)
+                        line(iw) = scr[iw];
+
+                    sycl::group_barrier(g);
+                }   // end for lines of the tile
+            }       // end lambda in parallel_for
+        );          // end parallel_for nd_range
+    });             // end Q.submit
+}   // end submit_ragged
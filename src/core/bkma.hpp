@@ -5,3 +5,9 @@
 #include <bkma_tools.hpp>
 #include <MemorySpace.hpp>
 #include <bkma_run.hpp>
+#include <bkma_cost_model.hpp>
+#include <bkma_batch_planner.hpp>
+#include <BkmaContext.hpp>
+#include <DeviceProfile.hpp>
+#include <ImplRegistry.hpp>
+#include <Ragged.hpp>
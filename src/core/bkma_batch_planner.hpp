@@ -0,0 +1,67 @@
+#pragma once
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <bkma_tools.hpp>
+#include <DeviceProfile.hpp>
+#include <MemorySpace.hpp>
+#include <types.hpp>
+#include <sycl/sycl.hpp>
+
+// ==========================================
+// ==========================================
+/* Largest batch of n lines that one launch can cover in a dimension with
+w work-items each processing s lines, under the device limits */
+[[nodiscard]] inline size_t
+max_batch_size(const size_t n, const size_t w, const size_t s,
+               const size_t max_work_groups, const size_t max_global_range) {
+    const auto max_groups = std::min(max_work_groups, max_global_range / w);
+    /* Groups needed to cover n, rounded up so a ragged tail is counted */
+    if (max_groups >= (n + w * s - 1) / (w * s))
+        return n;
+    return max_groups * w * s;
+}
+
+// ==========================================
+// ==========================================
+/* Splits dims 0 and 2 in batches that respect the launch limits of the
+device. With a global scratch (Global or Hybrid), one batch of b0*b2 lines
+of scratch_line_elems elements must also fit in dev.max_alloc_elems, b0
+is reduced first, then b2. Batch sizes stay multiples of w*s, throws when
+the scratch cannot hold the w0*s0 x w2*s2 lines of one work-group row. */
+[[nodiscard]] inline std::pair<BatchConfig1D, BatchConfig1D>
+plan_batchs(const DeviceProfile &dev, const size_t n0, const size_t n2,
+            const size_t w0, const size_t w2, const WorkGroupDispatch &wg,
+            const MemorySpace mem_space, const size_t scratch_line_elems) {
+    auto b0 = max_batch_size(n0, w0, wg.s0_, dev.max_work_groups[0],
+                             dev.max_global_range);
+    auto b2 = max_batch_size(n2, w2, wg.s2_, dev.max_work_groups[2],
+                             dev.max_global_range);
+
+    const auto max_lines = dev.max_alloc_elems / scratch_line_elems;
+    if (mem_space != MemorySpace::Local && b0 * b2 > max_lines) {
+        const auto step0 = w0 * wg.s0_;
+        const auto step2 = w2 * wg.s2_;
+        const auto min_lines = std::min(step0, b0) * std::min(step2, b2);
+        if (max_lines < min_lines) {
+            const auto mb = size_t{1024} * 1024;
+            const auto min_bytes =
+                min_lines * scratch_line_elems * sizeof(real_t);
+            throw std::invalid_argument(
+                "The global scratch holds " + std::to_string(max_lines) +
+                " lines, w0 = " + std::to_string(w0) +
+                ", w2 = " + std::to_string(w2) +
+                " and seq_size = (" + std::to_string(wg.s0_) + ", " +
+                std::to_string(wg.s2_) + ") need " +
+                std::to_string(min_lines) + " lines, at least " +
+                std::to_string((min_bytes + mb - 1) / mb) +
+                " MB of scratch");
+        }
+        b0 = std::max(step0, max_lines / b2 / step0 * step0);
+        if (b0 * b2 > max_lines)
+            b2 = std::max(step2, max_lines / b0 / step2 * step2);
+    }
+
+    return {init_1d_blocking(n0, b0), init_1d_blocking(n2, b2)};
+}   // end plan_batchs
@@ -0,0 +1,224 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <bkma_tools.hpp>
+#include <DeviceProfile.hpp>
+#include <MemorySpace.hpp>
+#include <types.hpp>
+#include <sycl/sycl.hpp>
+
+/* Smallest memory transaction (32B sectors on NVIDIA and AMD GPUs) */
+static constexpr size_t TRANSACTION_BYTES = 32;
+/* Hardware limit of resident work-groups per compute unit */
+static constexpr size_t MAX_RESIDENT_WG = 32;
+
+// ==========================================
+// ==========================================
+/* One point of the dispatch space explored by the planner */
+struct DispatchCandidate {
+    size_t w0, w1, w2;
+    size_t s0, s2;
+    MemorySpace mem_space;
+};
+
+// ==========================================
+// ==========================================
+/* Predicted behaviour of one bkma_run call for a candidate */
+struct CostEstimate {
+    double bytes_moved;       // global memory traffic
+    double occupancy;         // fraction of the device work-item slots used
+    size_t local_mem_bytes;   // local memory per work-group
+    double coalescing;        // useful fraction of each memory transaction
+    double cost;              // relative, lower is better, inf if invalid
+};
+
+// ==========================================
+// ==========================================
+/* Fraction of the memory transactions that is useful when consecutive
+work-items access a run of contiguous elements */
+[[nodiscard]] inline double
+transaction_efficiency(const size_t contiguous_run) {
+    const auto run_bytes = contiguous_run * sizeof(real_t);
+    return static_cast<double>(std::min(run_bytes, TRANSACTION_BYTES)) /
+           static_cast<double>(TRANSACTION_BYTES);
+}
+
+// ==========================================
+// ==========================================
+/* Cost of a candidate for the problem described by the extents and strides
+of data. The model assumes:
+ - each element of data is read once and each output written once, the
+   global scratch adds one write and one read per output;
+ - the work-item slots of a compute unit are 2*max_wg_size, at most
+   MAX_RESIDENT_WG work-groups are resident and latency is hidden past half
+   of the slots;
+ - work-items consecutive in dim2 (then dim1) issue consecutive accesses. */
+[[nodiscard]] inline CostEstimate
+estimate_cost(const DeviceProfile &dev, const DispatchCandidate &c,
+              const span3d_t &data, const size_t window) {
+    const auto n0 = data.extent(0);
+    const auto n1 = data.extent(1);
+    const auto n2 = data.extent(2);
+    const auto nw = n1 - (window - 1);
+    const auto n_lines = static_cast<double>(n0 * n2);
+
+    CostEstimate est;
+    est.cost = std::numeric_limits<double>::infinity();
+
+    /* Memory footprint, the local kernels stage whole lines */
+    est.local_mem_bytes =
+        c.mem_space == MemorySpace::Local ? c.w0 * c.w2 * n1 * sizeof(real_t)
+                                          : 0;
+    if (est.local_mem_bytes > dev.local_mem_size)
+        return est;
+
+    const double data_bytes = n_lines * (n1 + nw) * sizeof(real_t);
+    const double scratch_bytes = c.mem_space == MemorySpace::Global
+                                     ? n_lines * 2 * nw * sizeof(real_t)
+                                     : 0.;
+    est.bytes_moved = data_bytes + scratch_bytes;
+
+    /* Coalescing: consecutive work-items in dim2 are contiguous. When the
+    work-group spans the whole stride of dim1 (resp. dim0) the work-items in
+    dim1 (resp. dim0) continue the contiguous run. */
+    auto data_run = c.w2;
+    if (c.w2 == data.stride(1)) {
+        data_run *= c.w1;
+        if (c.w1 * c.w2 == data.stride(0))
+            data_run *= c.w0;
+    }
+    const auto data_coal = transaction_efficiency(data_run);
+    /* Global scratch is (i0, i2, iw): only work-items in dim1 are contiguous */
+    const auto scratch_coal = transaction_efficiency(c.w1);
+    est.coalescing = (data_bytes * data_coal + scratch_bytes * scratch_coal) /
+                     est.bytes_moved;
+
+    /* Occupancy: resident work-groups per compute unit, limited by work-item
+    slots and local memory, then wave quantization of the grid */
+    const auto wg_size = c.w0 * c.w1 * c.w2;
+    const auto slots = 2 * dev.max_wg_size;
+    auto resident = std::min(MAX_RESIDENT_WG, slots / wg_size);
+    if (est.local_mem_bytes > 0)
+        resident =
+            std::min(resident, dev.local_mem_size / est.local_mem_bytes);
+    if (resident == 0)
+        return est;
+
+    const auto n_wg = std::max<size_t>(1, (n0 / (c.s0 * c.w0)) *
+                                              (n2 / (c.s2 * c.w2)));
+    const auto wave = resident * dev.compute_units;
+    const auto n_waves = (n_wg + wave - 1) / wave;
+    const auto cu_fill = static_cast<double>(resident * wg_size) / slots;
+    const auto tail_fill = static_cast<double>(n_wg) / (n_waves * wave);
+    est.occupancy = cu_fill * tail_fill;
+
+    /* Idle work-items in the last stride of the dim1 loop */
+    const auto n1_iters = (n1 + c.w1 - 1) / c.w1;
+    const auto dim1_use = static_cast<double>(n1) / (n1_iters * c.w1);
+
+    const auto latency_hiding = std::min(1., 2. * est.occupancy);
+    est.cost = est.bytes_moved / (est.coalescing * latency_hiding * dim1_use);
+    return est;
+}   // end estimate_cost
+
+// ==========================================
+// ==========================================
+/* Sizes tried for one dimension: powers of two up to min(n, max) and n
+itself. In the batch dimensions only divisors of n are kept so that every
+work-item of a work-group runs the same number of lines (they share
+barriers). */
+[[nodiscard]] inline std::vector<size_t>
+candidate_sizes(const size_t n, const size_t max, const bool divisors_only) {
+    std::vector<size_t> sizes;
+    for (size_t w = 1; w <= std::min(n, max); w *= 2)
+        if (!divisors_only || n % w == 0)
+            sizes.push_back(w);
+    if (n <= max && (sizes.empty() || sizes.back() != n))
+        sizes.push_back(n);
+    return sizes;
+}
+
+// ==========================================
+// ==========================================
+/* Picks the cheapest candidate according to estimate_cost. Ties are broken
+by the global traffic, then by the largest work-group. */
+[[nodiscard]] inline DispatchCandidate
+plan_dispatch(const DeviceProfile &dev, const span3d_t &data,
+              const size_t window, const bool allow_global_scratch) {
+    const auto n0 = data.extent(0);
+    const auto n1 = data.extent(1);
+    const auto n2 = data.extent(2);
+
+    std::vector<MemorySpace> mem_spaces{MemorySpace::Local};
+    if (allow_global_scratch)
+        mem_spaces.push_back(MemorySpace::Global);
+
+    DispatchCandidate best{};
+    CostEstimate best_est{};
+    best_est.cost = std::numeric_limits<double>::infinity();
+
+    auto is_better = [&](const CostEstimate &est, const DispatchCandidate &c) {
+        if (est.cost < best_est.cost * (1 - 1e-6))
+            return true;
+        if (est.cost > best_est.cost * (1 + 1e-6))
+            return false;
+        if (est.bytes_moved != best_est.bytes_moved)
+            return est.bytes_moved < best_est.bytes_moved;
+        return c.w0 * c.w1 * c.w2 > best.w0 * best.w1 * best.w2;
+    };
+
+    const auto max_wg = dev.max_wg_size;
+    for (auto w2 : candidate_sizes(n2, max_wg, true))
+        for (auto w1 : candidate_sizes(n1, max_wg / w2, false))
+            for (auto w0 : candidate_sizes(n0, max_wg / (w2 * w1), true))
+                for (size_t s0 : {1, 2, 4})
+                    for (size_t s2 : {1, 2, 4}) {
+                        if (s0 * w0 > n0 || s2 * w2 > n2 ||
+                            w0 > dev.max_wi_sizes[0] ||
+                            w1 > dev.max_wi_sizes[1] ||
+                            w2 > dev.max_wi_sizes[2])
+                            continue;
+                        for (auto mem_space : mem_spaces) {
+                            DispatchCandidate c{w0, w1, w2, s0, s2, mem_space};
+                            auto est = estimate_cost(dev, c, data, window);
+                            if (std::isfinite(est.cost) && is_better(est, c)) {
+                                best_est = est;
+                                best = c;
+                            }
+                        }
+                    }
+
+    if (!std::isfinite(best_est.cost))
+        throw std::invalid_argument(
+            "No dispatch fits the device, the lines do not fit in local "
+            "memory. Allow the global scratch.");
+
+    return best;
+}   // end plan_dispatch
+
+// ==========================================
+// ==========================================
+/* Fraction of the lines to process with local scratch in Hybrid mode. The
+local kernels are limited to the occupancy their scratch allows, the global
+kernels fill the remaining work-item slots but move twice the data. The
+fraction balances both so that they finish together: 1 when local memory
+does not limit the occupancy, 0 when a work-group does not fit. */
+[[nodiscard]] inline float
+hybrid_local_fraction(const DeviceProfile &dev, const size_t w0,
+                      const size_t w1, const size_t w2, const size_t n1) {
+    const auto local_mem_bytes = w0 * w2 * n1 * sizeof(real_t);
+    if (local_mem_bytes > dev.local_mem_size)
+        return 0.f;
+
+    const auto wg_size = w0 * w1 * w2;
+    const auto slots = 2 * dev.max_wg_size;
+    const auto resident =
+        std::min({MAX_RESIDENT_WG, slots / wg_size,
+                  dev.local_mem_size / local_mem_bytes});
+    const auto occupancy =
+        std::min(1., static_cast<double>(resident * wg_size) / slots);
+
+    return occupancy / (occupancy + (1. - occupancy) / 2.);
+}   // end hybrid_local_fraction
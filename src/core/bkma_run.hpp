@@ -1,22 +1,60 @@
 #pragma once
+#include <algorithm>
+#include <deque>
+#include <string>
+#include <vector>
 #include <bkma_tools.hpp>
+#include <ImplRegistry.hpp>
 #include <MemorySpace.hpp>
 #include <types.hpp>
 
 #include <BasicRange.hpp>
 #include <NDRange.hpp>
 #include <AdaptiveWg.hpp>
+#include <Persistent.hpp>
 
+// ==========================================
+// ==========================================
+/* Returns an event that completes when all the events in deps complete */
+[[nodiscard]] inline sycl::event
+join_events(sycl::queue &Q, const std::vector<sycl::event> &deps) {
+    if (deps.size() == 1)
+        return deps.front();
+
+    return Q.submit([&](sycl::handler &cgh) {
+        cgh.depends_on(deps);
+        cgh.single_task([=]() {});
+    });
+}   // end join_events
+
+// ==========================================
+// ==========================================
+/* Submits the kernels of Impl batch by batch, every batch waits on
+step_deps */
 template <class MySolver, BkmaImpl Impl>
 inline sycl::event
-bkma_run(sycl::queue &Q, span3d_t data, const MySolver &solver,
-         BkmaOptimParams optim_params, span3d_t global_scratch = span3d_t{}) {
+run_batchs(sycl::queue &Q, span3d_t data, const MySolver &solver,
+           BkmaOptimParams optim_params, span3d_t global_scratch,
+           const std::vector<sycl::event> &step_deps) {
 
-    sycl::event last_event;
+    using Traits = ImplTraits<Impl>;
+    const auto mem_space = optim_params.mem_space;
+    if ((mem_space != MemorySpace::Global && !Traits::local_scratch) ||
+        (mem_space != MemorySpace::Local && !Traits::global_scratch))
+        throw std::invalid_argument(std::string(Traits::name) +
+                                    " does not support the " +
+                                    mem_space_to_string(mem_space) +
+                                    " memory space");
 
     auto const &n_batch0 = optim_params.dispatch_d0.n_batch_;
     auto const &n_batch2 = optim_params.dispatch_d2.n_batch_;
 
+    /* Batches are disjoint slices of data, up to in_flight of them are
+    submitted before the host waits on the oldest one */
+    auto const in_flight = std::max<size_t>(optim_params.batchs_in_flight, 1);
+    std::vector<sycl::event> batch_events;
+    batch_events.reserve(n_batch0 * n_batch2);
+
     for (size_t i0_batch = 0; i0_batch < n_batch0; ++i0_batch) {
         bool last_i0 = (i0_batch == n_batch0 - 1);
         auto const offset_d0 = optim_params.dispatch_d0.offset(i0_batch);
@@ -32,22 +70,64 @@ bkma_run(sycl::queue &Q, span3d_t data, const MySolver &solver,
                 last_i2 ? optim_params.dispatch_d2.last_batch_size_
                         : optim_params.dispatch_d2.batch_size_;
 
-            last_event.wait();
+            auto const ibatch = batch_events.size();
+            if (ibatch >= in_flight)
+                batch_events[ibatch - in_flight].wait();
+
+            /* The global scratch is shared by all the batches */
+            std::vector<sycl::event> deps = step_deps;
+            if (optim_params.mem_space != MemorySpace::Local && ibatch > 0)
+                deps.push_back(batch_events.back());
+
             switch (optim_params.mem_space) {
             case MemorySpace::Local: {
-                last_event = submit_kernels<MemorySpace::Local, MySolver, Impl>(
-                    Q, data, solver, batch_size_d0, offset_d0,
-                    batch_size_d2, offset_d2, optim_params.w0, optim_params.w1,
-                    optim_params.w2, optim_params.wg_dispatch);
+                if constexpr (Traits::local_scratch)
+                    batch_events.push_back(
+                        submit_kernels<MemorySpace::Local, MySolver, Impl>(
+                            Q, data, solver, batch_size_d0, offset_d0,
+                            batch_size_d2, offset_d2, optim_params.w0,
+                            optim_params.w1, optim_params.w2,
+                            optim_params.wg_dispatch, deps));
             } break;
 
             case MemorySpace::Global: {
-                last_event =
-                    submit_kernels<MemorySpace::Global, MySolver, Impl>(
-                        Q, data, solver, batch_size_d0, offset_d0,
-                        batch_size_d2, offset_d2, optim_params.w0,
-                        optim_params.w1, optim_params.w2,
-                        optim_params.wg_dispatch, global_scratch);
+                if constexpr (Traits::global_scratch)
+                    batch_events.push_back(
+                        submit_kernels<MemorySpace::Global, MySolver, Impl>(
+                            Q, data, solver, batch_size_d0, offset_d0,
+                            batch_size_d2, offset_d2, optim_params.w0,
+                            optim_params.w1, optim_params.w2,
+                            optim_params.wg_dispatch, deps, global_scratch));
+            } break;
+
+            case MemorySpace::Hybrid: {
+                if constexpr (Traits::local_scratch &&
+                              Traits::global_scratch) {
+                    /* The first k_local lines of the batch use local scratch,
+                    the others run concurrently with global scratch */
+                    auto kd = dispatch_kernels(batch_size_d0,
+                                               optim_params.percent_loc);
+                    kd.k_local_ -= kd.k_local_ % optim_params.w0;
+                    kd.k_global_ = batch_size_d0 - kd.k_local_;
+
+                    std::vector<sycl::event> hybrid_events;
+                    if (kd.k_local_ > 0)
+                        hybrid_events.push_back(
+                            submit_kernels<MemorySpace::Local, MySolver, Impl>(
+                                Q, data, solver, kd.k_local_, offset_d0,
+                                batch_size_d2, offset_d2, optim_params.w0,
+                                optim_params.w1, optim_params.w2,
+                                optim_params.wg_dispatch, step_deps));
+                    if (kd.k_global_ > 0)
+                        hybrid_events.push_back(
+                            submit_kernels<MemorySpace::Global, MySolver, Impl>(
+                                Q, data, solver, kd.k_global_,
+                                offset_d0 + kd.k_local_, batch_size_d2,
+                                offset_d2, optim_params.w0, optim_params.w1,
+                                optim_params.w2, optim_params.wg_dispatch, deps,
+                                global_scratch));
+                    batch_events.push_back(join_events(Q, hybrid_events));
+                }
             } break;
 
             default: {
@@ -58,5 +138,79 @@ bkma_run(sycl::queue &Q, span3d_t data, const MySolver &solver,
         } // end for i2_batch
     } // end for i0_batch
 
-    return last_event;
+    /* Every batch older than the last in_flight ones was already waited on */
+    auto const n_pending = std::min(in_flight, batch_events.size());
+    return join_events(Q, std::vector<sycl::event>(
+                              batch_events.end() - n_pending,
+                              batch_events.end()));
+} // end run_batchs
+
+// ==========================================
+// ==========================================
+/* Updates all the lines of data once. The kernels start after deps, so that
+successive calls can be enqueued without waiting on the host.
+Several host threads may call bkma_run at the same time, on one device or
+on several: bkma_run holds no state of its own, DeviceProfile::get is
+guarded by a mutex, and everything mutable is passed in. Each thread needs
+its own data, global scratch and work_counters, that is its own
+BkmaContext, and preferably its own queue. */
+template <class MySolver, BkmaImpl Impl>
+inline sycl::event
+bkma_run(sycl::queue &Q, span3d_t data, const MySolver &solver,
+         BkmaOptimParams optim_params, span3d_t global_scratch = span3d_t{},
+         const std::vector<sycl::event> &deps = {}) {
+    constexpr auto N1 = FixedN1<MySolver>::value;
+    if (N1 != 0 && data.extent(1) != N1)
+        throw std::invalid_argument(
+            "The solver is specialized for n1 = " + std::to_string(N1) +
+            ", data has n1 = " + std::to_string(data.extent(1)));
+    if constexpr (HasLinePasses<MySolver>::value) {
+        if (Impl != BkmaImpl::AdaptiveWg)
+            throw std::invalid_argument(
+                "Solvers with line passes need the AdaptiveWg kernel");
+        if (solver.window() != 1)
+            throw std::invalid_argument(
+                "Solvers with line passes must have a window of 1");
+    }
+
+    /* The persistent kernel covers all the lines in a single launch */
+    if constexpr (Impl == BkmaImpl::Persistent)
+        return submit_persistent(Q, data, solver, optim_params, deps);
+    else
+        return run_batchs<MySolver, Impl>(Q, data, solver, optim_params,
+                                          global_scratch, deps);
 } // end bkma_run
+
+// ==========================================
+// ==========================================
+/* Time steps enqueued ahead of the host: each step runs after the previous
+one, and the host waits on the oldest step once in_flight of them are
+pending */
+class StepsInFlight {
+    std::deque<sycl::event> steps_;
+    size_t in_flight_;
+
+  public:
+    StepsInFlight() = delete;
+    explicit StepsInFlight(const size_t in_flight)
+        : in_flight_(std::max<size_t>(in_flight, 1)) {}
+
+    /* Enqueues a step, run(deps) submits it after the events of deps */
+    template <typename RunFunction> void push(RunFunction &&run) {
+        if (steps_.size() == in_flight_) {
+            steps_.front().wait();
+            steps_.pop_front();
+        }
+        std::vector<sycl::event> deps;
+        if (!steps_.empty())
+            deps.push_back(steps_.back());
+        steps_.push_back(run(deps));
+    }
+
+    /* Waits on the pending steps */
+    void wait() {
+        for (auto &step : steps_)
+            step.wait();
+        steps_.clear();
+    }
+};   // end class StepsInFlight
@@ -3,6 +3,8 @@
 #include <iostream>
 #include <MemorySpace.hpp>
 #include <stdexcept>
+#include <type_traits>
+#include <utility>
 #include <types.hpp>
 #include <sycl/sycl.hpp>
 
@@ -10,6 +12,7 @@ enum class BkmaImpl {
     BasicRange,
     NDRange,
     AdaptiveWg,
+    Persistent,
 };
 
 // ==========================================
@@ -83,7 +86,7 @@ struct WorkItemDispatch {
                 w2_ = n2;
             } else {
                 // Not enough n1*n2 to fill up work group, we use more from n0
-                w0_ = pref_wg_size / n1 * n2;
+                w0_ = pref_wg_size / (n1 * n2);
                 w1_ = n1;
                 w2_ = n2;
             }
@@ -98,6 +101,10 @@ struct WorkItemDispatch {
         pref_w? so it's not possible to exceed memory in that case right? */
         /* Adjust based on maximum memory available*/
         auto total_wi = size();
+        /* A single line does not fit, only the global scratch can be used */
+        if (alloc_size > max_elems_alloc)
+            return;
+
         if (w2_ * alloc_size >= max_elems_alloc) {
             w2_ = max_elems_alloc / alloc_size;
             w0_ = 1;
@@ -131,6 +138,12 @@ struct BkmaOptimParams {
     size_t w2;
     WorkGroupDispatch wg_dispatch;
     MemorySpace mem_space;
+    /* Maximum number of batches submitted before waiting on the oldest */
+    size_t batchs_in_flight = 1;
+    /* Fraction of the lines of a batch using local scratch (Hybrid only) */
+    float percent_loc = 1.f;
+    /* Two zeroed device counters used by the Persistent implementation */
+    size_t *work_counters = nullptr;
 };
 
 // ==========================================
@@ -140,14 +153,13 @@ init_1d_blocking(const size_t n, const size_t max_batchs) noexcept {
     BatchConfig1D bconf;
     /* If there is no problem, the max batch is n */
     bconf.batch_size_ = n < max_batchs ? n : max_batchs;
+    if (bconf.batch_size_ == 0)
+        return {0, 0, 0};
 
-    /* Compute number of batchs */
-    float div = static_cast<float>(n) / static_cast<float>(max_batchs);
-    auto floor_div = sycl::floor(div);
-    auto div_is_int = div == floor_div;
-    bconf.n_batch_ = div_is_int ? div : floor_div + 1;
-
-    bconf.last_batch_size_ = div_is_int ? max_batchs : (n % max_batchs);
+    /* Exact integer division, float rounding made n above 2^24 lose or
+    duplicate lines */
+    bconf.n_batch_ = (n + bconf.batch_size_ - 1) / bconf.batch_size_;
+    bconf.last_batch_size_ = n - (bconf.n_batch_ - 1) * bconf.batch_size_;
 
     return bconf;
 }
@@ -155,11 +167,47 @@ init_1d_blocking(const size_t n, const size_t max_batchs) noexcept {
 // ==========================================
 // ==========================================
 [[nodiscard]] inline KernelDispatch
-dispatch_kernels(const size_t n_kernels, const size_t p) noexcept {
+dispatch_kernels(const size_t n_kernels, const float p) noexcept {
     KernelDispatch kd;
-    float div = n_kernels * p;
-    kd.k_local_ = sycl::floor(div);
+    kd.k_local_ = static_cast<size_t>(static_cast<double>(n_kernels) * p);
     kd.k_global_ = n_kernels - kd.k_local_;
 
     return kd;
 }   // end dispach_kernels
+
+// ==========================================
+// ==========================================
+/* Line length a solver is specialized for, read from its static constexpr
+fixed_n1 member, 0 when the solver handles any n1 */
+template <class MySolver, class = void>
+struct FixedN1 : std::integral_constant<size_t, 0> {};
+
+template <class MySolver>
+struct FixedN1<MySolver, std::void_t<decltype(MySolver::fixed_n1)>>
+    : std::integral_constant<size_t, MySolver::fixed_n1> {};
+
+/* n1 in the kernels: a compile time constant for a specialized solver, so
+that the loops over a line have constant bounds */
+template <class MySolver>
+[[nodiscard]] inline constexpr size_t
+kernel_n1(const size_t n1) noexcept {
+    if constexpr (FixedN1<MySolver>::value != 0)
+        return FixedN1<MySolver>::value;
+    else
+        return n1;
+}
+
+// ==========================================
+// ==========================================
+/* Whether a solver makes passes over its whole lines before they are
+interpolated. Such a solver has a line_passes() member, uniform over the
+lines of a launch, and pass p computes each cell of a line with
+solver.line_pass(line, p, i0, i1, i2) from the line left by pass p - 1, the
+first pass reading the data. Its window must be 1. */
+template <class MySolver, class = void>
+struct HasLinePasses : std::false_type {};
+
+template <class MySolver>
+struct HasLinePasses<
+    MySolver, std::void_t<decltype(std::declval<const MySolver &>()
+                                       .line_passes())>> : std::true_type {};
@@ -0,0 +1,41 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <sycl/sycl.hpp>
+#include <ConfigMap.h>
+#include <init.hpp>
+#include <job_service.hpp>
+
+// ==========================================
+// ==========================================
+/* Long-running service: keeps the device warm and serves advection and
+conv1d jobs sent on a Unix socket, see BkmaService */
+int
+main(int argc, char **argv) {
+    std::string input_file = argc > 1 ? std::string(argv[1]) : "service.ini";
+    ConfigMap configMap(input_file);
+
+    const auto socket_path =
+        configMap.getString("service", "socket", "/tmp/bkma.sock");
+    const auto window = std::chrono::microseconds(
+        configMap.getInteger("service", "coalesce_us", 500));
+    const size_t max_batch_cells =
+        configMap.getInteger("service", "max_batch_mcells", 256) * 1000000;
+    const auto read_timeout = std::chrono::milliseconds(
+        configMap.getInteger("service", "read_timeout_ms", 10000));
+    const size_t max_clients =
+        configMap.getInteger("service", "max_clients", 64);
+
+    auto device = pick_device(configMap.getBool("optimization", "gpu", true));
+    sycl::queue Q{device, rethrow_async_errors};
+    std::cout << "Using device: "
+              << Q.get_device().get_info<sycl::info::device::name>() << "\n";
+
+    BkmaService service(Q, window, max_batch_cells, read_timeout,
+                        max_clients);
+    service.warmup();
+
+    std::cout << "Listening on " << socket_path << std::endl;
+    service.serve(socket_path);
+    return 0;
+}
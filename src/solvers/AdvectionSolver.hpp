@@ -1,60 +1,110 @@
 #pragma once
 
 #include <AdvectionParams.hpp>
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
 #include <sycl/sycl.hpp>
 
-/* Lagrange variables, order, number of points, offset from the current point */
-int static constexpr LAG_ORDER = 5;
-int static constexpr LAG_PTS = 6;
-int static constexpr LAG_OFFSET = 2;
-real_t static constexpr loc[] = {-1. / 24, 1. / 24.,  -1. / 12.,
-                                 1. / 12., -1. / 24., 1. / 24.};
+// ==========================================
+// ==========================================
+/* Lagrange interpolation of order Order on the Order + 1 nodes 0 to Order
+around the foot of a characteristic, which lies between the nodes offset and
+offset + 1. The denominators of the basis are computed at compile time. */
+template <int Order> struct Lagrange {
+    static_assert(Order == 3 || Order == 5 || Order == 7 || Order == 9,
+                  "Lagrange interpolation of order 3, 5, 7 or 9");
+
+    static constexpr int order = Order;
+    static constexpr int pts = Order + 1;
+    static constexpr int offset = (Order - 1) / 2;
+
+    /* 1 / prod_{j != k} (k - j) */
+    static constexpr std::array<real_t, pts> weights = [] {
+        std::array<real_t, pts> w{};
+        for (int k = 0; k < pts; ++k) {
+            real_t prod = 1;
+            for (int j = 0; j < pts; ++j)
+                if (j != k)
+                    prod *= k - j;
+            w[k] = 1 / prod;
+        }
+        return w;
+    }();
+
+    // ==========================================
+    /* Basis at px, the position of the foot from node 0, as the products of
+    the factors left and right of each node */
+    [[nodiscard]] static inline
+        __attribute__((always_inline)) std::array<real_t, pts>
+        basis(const real_t px) noexcept {
+        std::array<real_t, pts> coef;
+        real_t left = 1.;
+#pragma unroll
+        for (int k = 0; k < pts; ++k) {
+            coef[k] = left * weights[k];
+            left *= px - k;
+        }
+        real_t right = 1.;
+#pragma unroll
+        for (int k = pts - 1; k >= 0; --k) {
+            coef[k] *= right;
+            right *= px - k;
+        }
+        return coef;
+    }   // end basis
+};
 
-struct AdvectionSolver {
+/* Order of AdvectionSolver, and its number of points and offset */
+int static constexpr LAG_ORDER = 5;
+int static constexpr LAG_PTS = Lagrange<LAG_ORDER>::pts;
+int static constexpr LAG_OFFSET = Lagrange<LAG_ORDER>::offset;
+
+/* Semi-Lagrangian advection with an interpolation of order Order. With N1
+a power of two the solver, and the kernels running it, only handle lines of
+N1 cells: the line length is a compile time constant and the periodic wrap
+of the stencil a mask. N1 = 0 handles any params.n1. */
+template <int Order, size_t N1 = 0> struct LagrangeSolver {
+    static_assert((N1 & (N1 - 1)) == 0, "N1 must be 0 or a power of two");
+
+    using Lag = Lagrange<Order>;
+    static constexpr size_t fixed_n1 = N1;
     ADVParams params;
 
-    AdvectionSolver() = delete;
-    AdvectionSolver(const ADVParams &p) : params(p){};
+    LagrangeSolver() = delete;
+    LagrangeSolver(const ADVParams &p) : params(p) {
+        if (N1 != 0 && p.n1 != N1)
+            throw std::invalid_argument("Solver specialized for n1 = " +
+                                        std::to_string(N1) + ", got " +
+                                        std::to_string(p.n1));
+    }
 
     auto inline constexpr window() const {return 1;}
     // ==========================================
     // ==========================================
     /* Computes the real position of x or speed of vx based on discretization */
     [[nodiscard]] static inline __attribute__((always_inline)) real_t
-    coord(const int i, const real_t &minValue, const real_t &delta) noexcept {
+    coord(const int64_t i, const real_t &minValue,
+          const real_t &delta) noexcept {
         return minValue + i * delta;
     }
 
     // ==========================================
     // ==========================================
-    /* Computes the coefficient for semi lagrangian interp of order 5 */
+    /* Computes the coefficients of the semi lagrangian interpolation */
     [[nodiscard]] static inline
-        __attribute__((always_inline)) std::array<real_t, LAG_PTS>
+        __attribute__((always_inline)) std::array<real_t, Lag::pts>
         lag_basis(real_t px) noexcept {
-        std::array<real_t, LAG_PTS> coef;
-
-        const real_t pxm2 = px - 2.;
-        const real_t sqrpxm2 = pxm2 * pxm2;
-        const real_t pxm2_01 = pxm2 * (pxm2 - 1.);
-
-        coef[0] = loc[0] * pxm2_01 * (pxm2 + 1.) * (pxm2 - 2.) * (pxm2 - 1.);
-        coef[1] = loc[1] * pxm2_01 * (pxm2 - 2.) * (5 * sqrpxm2 + pxm2 - 8.);
-        coef[2] = loc[2] * (pxm2 - 1.) * (pxm2 - 2.) * (pxm2 + 1.) *
-                  (5 * sqrpxm2 - 3 * pxm2 - 6.);
-        coef[3] = loc[3] * pxm2 * (pxm2 + 1.) * (pxm2 - 2.) *
-                  (5 * sqrpxm2 - 7 * pxm2 - 4.);
-        coef[4] =
-            loc[4] * pxm2_01 * (pxm2 + 1.) * (5 * sqrpxm2 - 11 * pxm2 - 2.);
-        coef[5] = loc[5] * pxm2_01 * pxm2 * (pxm2 + 1.) * (pxm2 - 2.);
-
-        return coef;
+        return Lag::basis(px);
     }   // end lag_basis
 
     // ==========================================
     // ==========================================
     /* Computes the covered distance by x during dt. returns the feet coord */
-    [[nodiscard]] inline __attribute__((always_inline)) real_t
-    displ(const int i1, const int i0) const noexcept {
+    [[nodiscard]] static inline __attribute__((always_inline)) real_t
+    displ(const ADVParams &params, const size_t i1, const size_t i0) noexcept {
         real_t const x = coord(i1, params.minRealX, params.dx);
         real_t const vx = coord(i0, params.minRealVx, params.dvx);
 
@@ -65,36 +115,117 @@ struct AdvectionSolver {
                           params.realWidthX);
     }   // end displ
 
+    [[nodiscard]] inline __attribute__((always_inline)) real_t
+    displ(const size_t i1, const size_t i0) const noexcept {
+        return displ(params, i1, i0);
+    }
+
     // ==========================================
     // ==========================================
-    /* The _solve_ function of the algorithm presented */
+    /* Interpolates the line data of velocity index i0 at the foot of the
+    characteristic of i1, for the problem described by params */
     template <class ArrayLike1D>
-    inline __attribute__((always_inline))
-    real_t operator()(const ArrayLike1D data, const size_t &i0,
-                      const size_t &i1, const size_t &i2) const {
+    static inline __attribute__((always_inline)) real_t
+    solve(const ADVParams &params, const ArrayLike1D data, const size_t &i0,
+          const size_t &i1) {
 
-        real_t const xFootCoord = displ(i1, i0);
+        real_t const xFootCoord = displ(params, i1, i0);
 
-        // index of the cell to the left of footCoord
-        const int leftNode =
+        // index of the cell to the left of footCoord, 64-bit as n1 may
+        // exceed INT_MAX
+        const int64_t leftNode =
             sycl::floor((xFootCoord - params.minRealX) * params.inv_dx);
 
         const real_t d_prev1 =
-            LAG_OFFSET +
+            Lag::offset +
             params.inv_dx *
                 (xFootCoord - coord(leftNode, params.minRealX, params.dx));
 
         auto coef = lag_basis(d_prev1);
 
-        const int ipos1 = leftNode - LAG_OFFSET;
+        const int64_t n1 = params.n1;
+        const int64_t ipos1 = leftNode - Lag::offset;
 
         real_t value = 0.;
-        for (int k = 0; k <= LAG_ORDER; k++) {
-            int id1_ipos = (params.n1 + ipos1 + k) % params.n1;
+#pragma unroll
+        for (int k = 0; k < Lag::pts; k++) {
+            size_t id1_ipos;
+            if constexpr (N1 != 0)
+                id1_ipos = (ipos1 + k) & (N1 - 1);
+            else
+                id1_ipos = (n1 + ipos1 + k) % n1;
 
             value += coef[k] * data(id1_ipos);
         }
 
         return value;
+    }   // end solve
+
+    // ==========================================
+    // ==========================================
+    /* The _solve_ function of the algorithm presented */
+    template <class ArrayLike1D>
+    inline __attribute__((always_inline))
+    real_t operator()(const ArrayLike1D data, const size_t &i0,
+                      const size_t &i1, const size_t &i2) const {
+        return solve(params, data, i0, i1);
+    }
+};
+
+using AdvectionSolver = LagrangeSolver<LAG_ORDER>;
+
+// ==========================================
+// ==========================================
+/* Calls f(std::integral_constant<int, order>{}), so that f can instantiate
+the solvers of the interpolation order chosen at runtime */
+template <class F>
+inline decltype(auto)
+visit_lag_order(const int order, F &&f) {
+    using std::integral_constant;
+    switch (order) {
+    case 3:
+        return f(integral_constant<int, 3>{});
+    case 5:
+        return f(integral_constant<int, 5>{});
+    case 7:
+        return f(integral_constant<int, 7>{});
+    case 9:
+        return f(integral_constant<int, 9>{});
+    default:
+        throw std::invalid_argument("Unsupported Lagrange order " +
+                                    std::to_string(order) +
+                                    ", use 3, 5, 7 or 9");
+    }
+}   // end visit_lag_order
+
+// ==========================================
+// ==========================================
+/* Calls f(std::integral_constant<size_t, n1>{}) when n1 is a power of two
+from 512 to 16384, f(std::integral_constant<size_t, 0>{}) otherwise, so that
+f can instantiate the solvers specialized for n1 and fall back to the
+generic ones. The specializations multiply the kernels to compile, they are only
+built with BKMA_FIXED_N1 defined (cmake -DADVECTION_FIXED_N1=ON). */
+template <class F>
+inline decltype(auto)
+visit_fixed_n1([[maybe_unused]] const size_t n1, F &&f) {
+    using std::integral_constant;
+#ifdef BKMA_FIXED_N1
+    switch (n1) {
+    case 512:
+        return f(integral_constant<size_t, 512>{});
+    case 1024:
+        return f(integral_constant<size_t, 1024>{});
+    case 2048:
+        return f(integral_constant<size_t, 2048>{});
+    case 4096:
+        return f(integral_constant<size_t, 4096>{});
+    case 8192:
+        return f(integral_constant<size_t, 8192>{});
+    case 16384:
+        return f(integral_constant<size_t, 16384>{});
+    default:
+        break;
     }
-};
\ No newline at end of file
+#endif
+    return f(integral_constant<size_t, 0>{});
+}   // end visit_fixed_n1
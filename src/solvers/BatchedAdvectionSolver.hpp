@@ -0,0 +1,35 @@
+#pragma once
+
+#include <AdvectionParams.hpp>
+#include <AdvectionSolver.hpp>
+#include <cstdint>
+#include <sycl/sycl.hpp>
+
+/* Dimension along which independent problems are stacked */
+enum class BatchAxis { D0, D2 };
+
+/* Advection of several independent problems stacked along n0 or n2 of one
+buffer. Each line reads the parameters of its problem from device tables,
+so that dt, the grid and the velocities differ between problems updated by
+the same launch. The tables are owned by AdvectionBatch. */
+struct BatchedAdvectionSolver {
+    const ADVParams *params;      // one record per problem
+    const size_t *offsets;        // first line of each problem along axis
+    const uint32_t *problem_of;   // problem of each line along axis
+    BatchAxis axis;
+
+    auto inline constexpr window() const { return 1; }
+
+    // ==========================================
+    // ==========================================
+    template <class ArrayLike1D>
+    inline __attribute__((always_inline)) real_t
+    operator()(const ArrayLike1D data, const size_t &i0, const size_t &i1,
+               const size_t &i2) const {
+        const auto p = problem_of[axis == BatchAxis::D0 ? i0 : i2];
+        /* Velocity index inside the problem */
+        const auto iv = axis == BatchAxis::D0 ? i0 - offsets[p] : i0;
+
+        return AdvectionSolver::solve(params[p], data, iv, i1);
+    }
+};
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <AdvectionParams.hpp>
+#include <AdvectionSolver.hpp>
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <sycl/sycl.hpp>
+
+/* Interpolation of every cell of the lines of one velocity: the stencil of
+i1 starts at cell (i1 + start) % n1 and uses the weights coef. When the
+displacement is a whole number of cells, the step is a rotation of the line
+and cell i1 takes the value of cell (i1 + start) % n1. */
+template <int Order = LAG_ORDER> struct AdvectionCoefs {
+    size_t start;
+    bool rotation;
+    std::array<real_t, Lagrange<Order>::pts> coef;
+};
+
+/* LagrangeSolver with the foot of the characteristics precomputed. With a
+constant dt the displacement dt*vx only depends on i0, so the shift of the
+stencil and the Lagrange weights are the same for every cell of the n2 lines
+of a velocity. The table is owned by AdvectionCoefCache. N1 != 0 fixes the
+line length at compile time, as for LagrangeSolver. */
+template <int Order = LAG_ORDER, size_t N1 = 0> struct CachedAdvectionSolver {
+    static constexpr size_t fixed_n1 = N1;
+    const AdvectionCoefs<Order> *coefs;   // one record per velocity
+    size_t n1;
+
+    auto inline constexpr window() const { return 1; }
+
+    // ==========================================
+    // ==========================================
+    /* A plain stencil, no coordinate nor polynomial evaluation, or a copy for
+    the rotated rows. The branch is uniform along a line. */
+    template <class ArrayLike1D>
+    inline __attribute__((always_inline)) real_t
+    operator()(const ArrayLike1D data, const size_t &i0, const size_t &i1,
+               const size_t &) const {
+        const size_t n1 = N1 != 0 ? N1 : this->n1;
+        const auto &c = coefs[i0];
+        auto id1 = i1 + c.start;
+        if (id1 >= n1)
+            id1 -= n1;
+        if (c.rotation)
+            return data(id1);
+
+        real_t value = 0.;
+#pragma unroll
+        for (int k = 0; k < Lagrange<Order>::pts; k++) {
+            value += c.coef[k] * data(id1);
+            if (++id1 == n1)
+                id1 = 0;
+        }
+        return value;
+    }
+};
+
+// ==========================================
+// ==========================================
+/* Device table of the n0 stencils of a problem, built once on the device.
+It is only valid for the dt it was built with, build a new cache when the
+time step changes. Velocities moving the line by a whole number of cells,
+up to params.shift_tol cell, are rotations: no rounding error and a single
+load per cell. */
+template <int Order = LAG_ORDER> class AdvectionCoefCache {
+    using Lag = Lagrange<Order>;
+    sycl::queue q_;
+    size_t n1_;
+    AdvectionCoefs<Order> *coefs_ = nullptr;
+
+  public:
+    AdvectionCoefCache() = delete;
+    AdvectionCoefCache(const AdvectionCoefCache &) = delete;
+    AdvectionCoefCache &operator=(const AdvectionCoefCache &) = delete;
+
+    AdvectionCoefCache(sycl::queue q, const ADVParams &params)
+        : q_(q), n1_(params.n1) {
+        if (params.n1 < Lag::pts)
+            throw std::invalid_argument(
+                "The coefficient cache needs n1 >= " +
+                std::to_string(Lag::pts));
+
+        coefs_ = sycl::malloc_device<AdvectionCoefs<Order>>(params.n0, q_);
+        if (!coefs_)
+            throw std::runtime_error("Failed to allocate the coefficients");
+
+        const auto coefs = coefs_;
+        q_.parallel_for(sycl::range<1>(params.n0), [=](sycl::id<1> i) {
+              coefs[i[0]] = make_coefs(params, i[0]);
+          }).wait();
+    }
+
+    // ==========================================
+    /* Stencil of the velocity i0, the foot of i1 is i1 + cells modulo n1 */
+    [[nodiscard]] static AdvectionCoefs<Order>
+    make_coefs(const ADVParams &params, const size_t i0) noexcept {
+        const real_t vx =
+            LagrangeSolver<Order>::coord(i0, params.minRealVx, params.dvx);
+        /* Displacement in cells, split in a shift and a fraction */
+        const real_t cells = -params.dt * vx * params.inv_dx;
+        real_t shift = sycl::floor(cells);
+        real_t frac = cells - shift;
+        if (frac > 1 - params.shift_tol) {
+            shift += 1;
+            frac = 0;
+        }
+
+        AdvectionCoefs<Order> c;
+        c.rotation = frac <= params.shift_tol;
+        c.coef = Lag::basis(Lag::offset + frac);
+
+        const int64_t n1 = params.n1;
+        const int64_t ipos1 =
+            static_cast<int64_t>(shift) - (c.rotation ? 0 : Lag::offset);
+        c.start = ((ipos1 % n1) + n1) % n1;
+        return c;
+    }
+
+    /* Number of velocities advanced by a rotation */
+    [[nodiscard]] static size_t
+    n_rotations(const ADVParams &params) noexcept {
+        size_t n = 0;
+        for (size_t i0 = 0; i0 < params.n0; ++i0)
+            n += make_coefs(params, i0).rotation;
+        return n;
+    }
+
+    ~AdvectionCoefCache() { sycl::free(coefs_, q_); }
+
+    /* N1 != 0 for the solver specialized on lines of N1 cells */
+    template <size_t N1 = 0>
+    [[nodiscard]] inline CachedAdvectionSolver<Order, N1> solver() const {
+        if (N1 != 0 && n1_ != N1)
+            throw std::invalid_argument("The cache holds lines of n1 = " +
+                                        std::to_string(n1_));
+        return {coefs_, n1_};
+    }
+};   // end class AdvectionCoefCache
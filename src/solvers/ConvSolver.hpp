@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <sycl/sycl.hpp>
 #include <experimental/mdspan>
 #include <types.hpp>
@@ -14,6 +15,20 @@ struct ConvSolver {
     static constexpr size_t padding_ = 0;
 
     auto inline window() const {return kernel_size_;}
+
+    /* A ragged line holds whole channels, else the output channel of its
+    last cells would read past the bias and the weights */
+    [[nodiscard]] inline bool valid_length(const size_t n1) const {
+        return n1 % in_channels_ == 0;
+    }
+
+    /* Solver of a ragged line of n1 = length * channels cells */
+    [[nodiscard]] inline ConvSolver for_line(const size_t n1) const {
+        ConvSolver line_solver = *this;
+        line_solver.input_length_ = n1 / in_channels_;
+        return line_solver;
+    }
+
     // ==========================================
     // ==========================================
     /* The _solve_ function of the algorithm presented */
@@ -32,9 +47,9 @@ struct ConvSolver {
         for (int ic = 0; ic < in_channels_; ++ic) {
             for (int k = 0; k < kernel_size_; ++k) {
                 // int input_idx = i1 * stride_ + k - padding_;
-                int input_idx = i_l - k;
+                const int64_t input_idx = static_cast<int64_t>(i_l) - k;
 
-                if (input_idx < scr.extent(0)) {
+                if (input_idx >= 0 && input_idx < int64_t(scr.extent(0))) {
                     sum += scr(input_idx) * weight_span_(k, ic, oc);
                 }
             }
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <AdvectionParams.hpp>
+#include <AdvectionSolver.hpp>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <sycl/sycl.hpp>
+
+// ==========================================
+// ==========================================
+/* Exact periodic shift of each line in Fourier space: forward FFT along
+dim1, multiplication of mode k by exp(-2 i pi k s / n1) for a shift of s
+cells, inverse FFT. Spectrally accurate for a constant velocity per line, at
+O(n1 log n1) per line; n1 must be a power of two.
+
+A line of n1 reals is read as m = n1 / 2 complex numbers, cells 2j and
+2j + 1 holding the real and imaginary parts of z_j, so that the FFTs are
+of length m and fit in the line. They are radix-2 Stockham stages, each one
+a line pass computing every cell from two complex numbers of the previous
+one:
+ - passes 0 to log2(m) - 1: forward FFT of z,
+ - pass log2(m): spectrum of the real line from Z_k and Z_{m-k}, phase
+   shift, and packing of the shifted spectrum for the inverse FFT,
+ - the next passes and operator(): inverse FFT, whose output is the shifted
+   line in natural order.
+The Nyquist mode is shifted by its real part, so that the line stays real.
+The AdaptiveWg kernel runs the passes in local memory, or in the global
+scratch for lines that don't fit. */
+struct SpectralSolver {
+    ADVParams params;
+    int log2_m;   // stages of each FFT
+
+    SpectralSolver() = delete;
+    SpectralSolver(const ADVParams &p) : params(p), log2_m(0) {
+        if (p.n1 < 4 || (p.n1 & (p.n1 - 1)) != 0)
+            throw std::invalid_argument(
+                "The spectral solver needs n1 a power of two >= 4, got " +
+                std::to_string(p.n1));
+        while ((size_t(2) << log2_m) < p.n1)
+            ++log2_m;
+    }
+
+    auto inline constexpr window() const { return 1; }
+    /* Forward FFT, phase shift, inverse FFT but its last stage */
+    auto inline line_passes() const { return 2 * log2_m; }
+
+    // ==========================================
+    // ==========================================
+    /* Complex numbers as pairs of reals, std::complex is not available on
+    every SYCL device */
+    struct Cplx {
+        real_t re;
+        real_t im;
+    };
+
+    [[nodiscard]] static inline __attribute__((always_inline)) Cplx
+    mul(const Cplx a, const Cplx b) noexcept {
+        return {a.re * b.re - a.im * b.im, a.re * b.im + a.im * b.re};
+    }
+
+    /* exp(i pi x) */
+    [[nodiscard]] static inline __attribute__((always_inline)) Cplx
+    expi_pi(const real_t x) noexcept {
+        return {sycl::cospi(x), sycl::sinpi(x)};
+    }
+
+    template <class ArrayLike1D>
+    [[nodiscard]] static inline __attribute__((always_inline)) Cplx
+    load(const ArrayLike1D line, const size_t j) {
+        return {line(2 * j), line(2 * j + 1)};
+    }
+
+    // ==========================================
+    // ==========================================
+    /* Cell c of the output of the Stockham stage s of an FFT of length m,
+    sign -1 forward and +1 inverse. The butterflies of width 2l = 2^(s+1)
+    combine z_j and z_{j+m/2} into the outputs o and o + l. */
+    template <class ArrayLike1D>
+    static inline __attribute__((always_inline)) real_t
+    stage(const ArrayLike1D src, const int s, const real_t sign,
+          const size_t c, const size_t m) {
+        const size_t l = size_t(1) << s;
+        const size_t o = c / 2;
+        const size_t r = o & (2 * l - 1);
+        const bool upper = r >= l;
+        const size_t k = upper ? r - l : r;
+        const size_t j = (o - r) / 2 + k;
+
+        const auto a = load(src, j);
+        const auto w = expi_pi(sign * real_t(k) / l);
+        const auto wb = mul(w, load(src, j + m / 2));
+        const Cplx out = upper ? Cplx{a.re - wb.re, a.im - wb.im}
+                               : Cplx{a.re + wb.re, a.im + wb.im};
+        return c % 2 == 0 ? out.re : out.im;
+    }   // end stage
+
+    // ==========================================
+    // ==========================================
+    /* Mode k of the real line of n = 2m cells from the FFT Z of its packed
+    form, k from 0 to m, times the phase of a shift of the line by s cells */
+    template <class ArrayLike1D>
+    static inline __attribute__((always_inline)) Cplx
+    shifted_mode(const ArrayLike1D Z, const size_t k, const size_t m,
+                 const real_t s) {
+        const auto zk = load(Z, k % m);
+        const auto zq = load(Z, (m - k) % m);
+        /* Spectra of the even and odd cells */
+        const Cplx even{(zk.re + zq.re) / 2, (zk.im - zq.im) / 2};
+        const Cplx odd{(zk.im + zq.im) / 2, (zq.re - zk.re) / 2};
+
+        const auto tw = mul(expi_pi(-real_t(k) / m), odd);
+        const Cplx mode{even.re + tw.re, even.im + tw.im};
+        if (k == m)
+            return {mode.re * sycl::cospi(s), 0};
+        return mul(mode, expi_pi(-real_t(k) * s / m));
+    }   // end shifted_mode
+
+    /* Packed spectrum Y_k of the shifted line, scaled by 1 / m for the
+    inverse FFT */
+    template <class ArrayLike1D>
+    static inline __attribute__((always_inline)) real_t
+    shift(const ArrayLike1D Z, const size_t c, const size_t m,
+          const real_t s) {
+        const size_t k = c / 2;
+        const auto gk = shifted_mode(Z, k, m, s);
+        const auto gq = shifted_mode(Z, m - k, m, s);
+
+        const Cplx even{(gk.re + gq.re) / 2, (gk.im - gq.im) / 2};
+        /* (G_k - conj(G_{m-k})) / 2 exp(2 i pi k / n) */
+        const auto odd = mul(Cplx{(gk.re - gq.re) / 2, (gk.im + gq.im) / 2},
+                             expi_pi(real_t(k) / m));
+        /* even + i odd */
+        return c % 2 == 0 ? (even.re - odd.im) / m : (even.im + odd.re) / m;
+    }   // end shift
+
+    // ==========================================
+    // ==========================================
+    /* Shift of the lines of velocity i0 in cells */
+    [[nodiscard]] inline __attribute__((always_inline)) real_t
+    cells(const size_t i0) const noexcept {
+        const real_t vx =
+            AdvectionSolver::coord(i0, params.minRealVx, params.dvx);
+        return params.dt * vx * params.inv_dx;
+    }
+
+    template <class ArrayLike1D>
+    inline __attribute__((always_inline)) real_t
+    line_pass(const ArrayLike1D src, const int pass, const size_t &i0,
+              const size_t &i1, const size_t &) const {
+        const size_t m = params.n1 / 2;
+        if (pass < log2_m)
+            return stage(src, pass, -1, i1, m);
+        if (pass == log2_m)
+            return shift(src, i1, m, cells(i0));
+        return stage(src, pass - log2_m - 1, 1, i1, m);
+    }
+
+    /* Last stage of the inverse FFT */
+    template <class ArrayLike1D>
+    inline __attribute__((always_inline)) real_t
+    operator()(const ArrayLike1D src, const size_t &, const size_t &i1,
+               const size_t &) const {
+        return stage(src, log2_m - 1, 1, i1, params.n1 / 2);
+    }
+};   // end struct SpectralSolver
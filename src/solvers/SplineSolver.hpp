@@ -0,0 +1,116 @@
+#pragma once
+
+#include <AdvectionParams.hpp>
+#include <AdvectionSolver.hpp>
+#include <array>
+#include <cstdint>
+#include <sycl/sycl.hpp>
+
+// ==========================================
+// ==========================================
+/* Semi-Lagrangian advection with periodic cubic splines, as in vlp4D. The
+spline coefficients eta of a line solve the periodic tridiagonal system
+(eta[i-1] + 4 eta[i] + eta[i+1]) / 6 = f[i], then the foot of each cell is
+interpolated from 4 coefficients with the cubic B-spline weights.
+
+The system is solved by parallel cyclic reduction on the whole line, in
+local memory or in the global scratch, see line_pass. Its rows are all the
+same, so that the reduction only updates the right hand side: level p
+combines the rows i, i - 2^p and i + 2^p, and squares the ratio r between
+the off-diagonal and the diagonal terms. Starting from r = 1/4,
+|r| < 1e-18 after n_levels levels and the right hand side is the solution to
+the machine precision. Only the AdaptiveWg kernel runs the line passes. */
+struct SplineSolver {
+    static constexpr int n_levels = 5;
+    ADVParams params;
+
+    SplineSolver() = delete;
+    SplineSolver(const ADVParams &p) : params(p) {}
+
+    auto inline constexpr window() const { return 1; }
+    auto inline constexpr line_passes() const { return n_levels; }
+
+    /* Off-diagonal over diagonal ratio at each level of the reduction */
+    static constexpr std::array<real_t, n_levels> ratio = [] {
+        std::array<real_t, n_levels> r{};
+        r[0] = 0.25;
+        for (int p = 1; p < n_levels; ++p)
+            r[p] = -r[p - 1] * r[p - 1] / (1 - 2 * r[p - 1] * r[p - 1]);
+        return r;
+    }();
+
+    // ==========================================
+    // ==========================================
+    /* Level pass of the reduction for the cell i1 of a line of n1 cells,
+    from the right hand sides of the previous level. Pass 0 reads f and
+    scales the rows by 6 / 4 so that their diagonal is 1. */
+    template <class ArrayLike1D>
+    static inline __attribute__((always_inline)) real_t
+    reduce(const ArrayLike1D rhs, const int pass, const size_t i1,
+           const size_t n1) {
+        const size_t s = (size_t(1) << pass) % n1;
+        const auto r = ratio[pass];
+        const real_t scale = pass == 0 ? 1.5 : 1;
+
+        const auto left = rhs(i1 >= s ? i1 - s : i1 + n1 - s);
+        const auto right = rhs(i1 + s < n1 ? i1 + s : i1 + s - n1);
+        return scale * (rhs(i1) - r * (left + right)) / (1 - 2 * r * r);
+    }   // end reduce
+
+    template <class ArrayLike1D>
+    inline __attribute__((always_inline)) real_t
+    line_pass(const ArrayLike1D rhs, const int pass, const size_t &,
+              const size_t &i1, const size_t &) const {
+        return reduce(rhs, pass, i1, params.n1);
+    }
+
+    // ==========================================
+    // ==========================================
+    /* Cubic B-spline weights of the coefficients leftNode - 1 to
+    leftNode + 2, t the position of the foot from leftNode in cells */
+    [[nodiscard]] static inline
+        __attribute__((always_inline)) std::array<real_t, 4>
+        bspline_basis(const real_t t) noexcept {
+        const real_t t2 = t * t;
+        const real_t t3 = t2 * t;
+        const real_t u = 1 - t;
+        return {u * u * u / 6, (3 * t3 - 6 * t2 + 4) / 6,
+                (-3 * t3 + 3 * t2 + 3 * t + 1) / 6, t3 / 6};
+    }
+
+    // ==========================================
+    // ==========================================
+    /* Interpolates the spline of velocity i0 at the foot of the
+    characteristic of i1, eta holds the coefficients of the line */
+    template <class ArrayLike1D>
+    static inline __attribute__((always_inline)) real_t
+    solve(const ADVParams &params, const ArrayLike1D eta, const size_t &i0,
+          const size_t &i1) {
+        const real_t xFootCoord = AdvectionSolver::displ(params, i1, i0);
+
+        const int64_t leftNode =
+            sycl::floor((xFootCoord - params.minRealX) * params.inv_dx);
+        const real_t t =
+            params.inv_dx *
+            (xFootCoord -
+             AdvectionSolver::coord(leftNode, params.minRealX, params.dx));
+
+        const auto coef = bspline_basis(t);
+
+        const int64_t n1 = params.n1;
+        real_t value = 0.;
+#pragma unroll
+        for (int k = 0; k < 4; k++) {
+            const size_t id1 = (n1 + leftNode - 1 + k) % n1;
+            value += coef[k] * eta(id1);
+        }
+        return value;
+    }   // end solve
+
+    template <class ArrayLike1D>
+    inline __attribute__((always_inline)) real_t
+    operator()(const ArrayLike1D eta, const size_t &i0, const size_t &i1,
+               const size_t &) const {
+        return solve(params, eta, i0, i1);
+    }
+};   // end struct SplineSolver
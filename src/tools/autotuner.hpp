@@ -0,0 +1,229 @@
+#pragma once
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sycl/sycl.hpp>
+#include <bkma.hpp>
+#include <init.hpp>
+
+// ==========================================
+// ==========================================
+/* The knobs explored by the autotuner, the rest of BkmaOptimParams is
+derived from them by create_optim_params */
+struct TuningConfig {
+    size_t pref_wg_size;
+    size_t seq_size0;
+    size_t seq_size2;
+    MemorySpace mem_space;
+};
+
+// ==========================================
+// ==========================================
+/* On-disk cache of the fastest TuningConfig found for a (device, solver,
+problem shape). One entry per line:
+    <key> <pref_wg_size> <seq_size0> <seq_size2> <mem_space> <seconds>
+Not thread-safe, tune before running problems from several threads. */
+class TuningDB {
+    std::string path_;
+    std::map<std::string, std::pair<TuningConfig, double>> entries_;
+
+  public:
+    TuningDB() = delete;
+
+    explicit TuningDB(const std::string &path) : path_(path) {
+        std::ifstream file(path_);
+        std::string line;
+        while (std::getline(file, line)) {
+            std::istringstream iss(line);
+            std::string key, mem_space;
+            TuningConfig cfg;
+            double seconds;
+            if (iss >> key >> cfg.pref_wg_size >> cfg.seq_size0 >>
+                cfg.seq_size2 >> mem_space >> seconds) {
+                cfg.mem_space = mem_space_from_string(mem_space);
+                entries_[key] = {cfg, seconds};
+            }
+        }
+    }
+
+    // ==========================================
+    /* Key of a problem, whitespaces of the device name are replaced so that
+    the key stays a single token in the file */
+    [[nodiscard]] static std::string
+    make_key(const sycl::device &d, const std::string &solver_name,
+             const size_t n0, const size_t n1, const size_t n2) {
+        auto device_name = d.get_info<sycl::info::device::name>();
+        std::replace_if(
+            device_name.begin(), device_name.end(),
+            [](unsigned char c) { return std::isspace(c); }, '_');
+
+        std::ostringstream oss;
+        oss << device_name << '|' << solver_name << '|' << n0 << 'x' << n1
+            << 'x' << n2;
+        return oss.str();
+    }
+
+    // ==========================================
+    [[nodiscard]] std::optional<TuningConfig>
+    find(const std::string &key) const {
+        auto it = entries_.find(key);
+        if (it == entries_.end())
+            return std::nullopt;
+        return it->second.first;
+    }
+
+    // ==========================================
+    /* Stores the entry and rewrites the whole file */
+    void store(const std::string &key, const TuningConfig &cfg,
+               const double seconds) {
+        entries_[key] = {cfg, seconds};
+
+        std::ofstream file(path_, std::ios::trunc);
+        if (!file)
+            throw std::runtime_error("Cannot write tuning database " + path_);
+
+        for (const auto &[k, entry] : entries_) {
+            const auto &c = entry.first;
+            file << k << ' ' << c.pref_wg_size << ' ' << c.seq_size0 << ' '
+                 << c.seq_size2 << ' ' << mem_space_to_string(c.mem_space)
+                 << ' ' << entry.second << '\n';
+        }
+    }
+};   // end class TuningDB
+
+// ==========================================
+// ==========================================
+/* Builds the BkmaOptimParams of a tuning configuration, the batches are
+planned again for its memory space */
+template <typename Params>
+BkmaOptimParams
+make_optim_params(sycl::queue &q, const Params &params,
+                  const TuningConfig &cfg) {
+    Params tuned_params = params;
+    tuned_params.pref_wg_size = cfg.pref_wg_size;
+    tuned_params.seq_size0 = cfg.seq_size0;
+    tuned_params.seq_size2 = cfg.seq_size2;
+
+    auto p = create_optim_params<Params>(q, tuned_params);
+    if (p.mem_space == cfg.mem_space)
+        return p;
+
+    auto optim_params =
+        make_bkma_params(q, tuned_params, p.w0, p.w1, p.w2, p.wg_dispatch.s0_,
+                         p.wg_dispatch.s2_, cfg.mem_space);
+    optim_params.percent_loc = cfg.mem_space == MemorySpace::Local ? 1.f : 0.f;
+    return optim_params;
+}   // end make_optim_params
+
+// ==========================================
+// ==========================================
+/* Candidate configurations: power of two work-group sizes up to the device
+limit and small sequential sizes, with local or global scratch. The caller
+of bkma_run provides the global scratch, see BkmaContext. */
+[[nodiscard]] inline std::vector<TuningConfig>
+tuning_candidates(const sycl::device &d) {
+    const auto max_wg_size = DeviceProfile::get(d).max_wg_size;
+
+    std::vector<TuningConfig> candidates;
+    for (size_t wg = 32; wg <= max_wg_size; wg *= 2)
+        for (size_t s0 : {1, 2, 4})
+            for (size_t s2 : {1, 2, 4})
+                for (auto mem : {MemorySpace::Local, MemorySpace::Global})
+                    candidates.push_back({wg, s0, s2, mem});
+
+    return candidates;
+}   // end tuning_candidates
+
+// ==========================================
+// ==========================================
+/* Benchmarks every candidate with run(optim_params) and returns the fastest
+one with its mean time per run. run must not depend on the content of the
+buffer it updates since it is called many times. */
+template <typename Params, typename RunFunction>
+std::pair<TuningConfig, double>
+autotune(sycl::queue &q, const Params &params, RunFunction &&run,
+         const size_t n_reps = 3) {
+    std::optional<TuningConfig> best;
+    double best_time = std::numeric_limits<double>::max();
+
+    const auto candidates = tuning_candidates(q.get_device());
+
+    /* JIT the kernels before measuring, a failure shows up again with its
+    candidate below */
+    try {
+        run(make_optim_params(q, params, candidates.front())).wait_and_throw();
+    } catch (const std::invalid_argument &) {
+    } catch (const sycl::exception &) {
+    }
+
+    /* wait_and_throw hands the asynchronous kernel errors to the queue's
+    async handler, see rethrow_async_errors, so that a candidate failing on
+    the device is not timed */
+    for (const auto &cfg : candidates) {
+        try {
+            auto optim_params = make_optim_params(q, params, cfg);
+
+            run(optim_params).wait_and_throw();
+            auto start = std::chrono::high_resolution_clock::now();
+            for (size_t i = 0; i < n_reps; ++i)
+                run(optim_params).wait_and_throw();
+            auto end = std::chrono::high_resolution_clock::now();
+
+            const std::chrono::duration<double> elapsed = end - start;
+            const auto seconds = elapsed.count() / n_reps;
+            if (seconds < best_time) {
+                best_time = seconds;
+                best = cfg;
+            }
+        } catch (const std::invalid_argument &) {
+            /* Sizes incompatible with the problem shape */
+        } catch (const sycl::exception &) {
+            /* Configuration rejected by the device */
+        }
+    }
+
+    if (!best)
+        throw std::runtime_error("Autotuning found no valid configuration");
+
+    return {*best, best_time};
+}   // end autotune
+
+// ==========================================
+// ==========================================
+/* Looks up the tuning database for the problem, runs the autotuner and
+stores its result on a miss */
+template <typename Params, typename RunFunction>
+BkmaOptimParams
+tuned_optim_params(sycl::queue &q, const Params &params,
+                   const std::string &solver_name, const std::string &db_path,
+                   RunFunction &&run) {
+    TuningDB db(db_path);
+    const auto key = TuningDB::make_key(q.get_device(), solver_name, params.n0,
+                                        params.n1, params.n2);
+
+    if (auto cfg = db.find(key)) {
+        std::cout << "Using tuned configuration from " << db_path << "\n";
+        return make_optim_params(q, params, *cfg);
+    }
+
+    std::cout << "Autotuning " << key << "..." << std::endl;
+    auto [cfg, seconds] = autotune(q, params, run);
+    db.store(key, cfg, seconds);
+
+    std::cout << "Best configuration: pref_wg_size=" << cfg.pref_wg_size
+              << " seq_size0=" << cfg.seq_size0
+              << " seq_size2=" << cfg.seq_size2
+              << " mem_space=" << mem_space_to_string(cfg.mem_space) << " ("
+              << seconds << " s)\n"
+              << std::endl;
+
+    return make_optim_params(q, params, cfg);
+}   // end tuned_optim_params
@@ -0,0 +1,155 @@
+#pragma once
+#include <AdvectionParams.hpp>
+#include <BatchedAdvectionSolver.hpp>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include <sycl/sycl.hpp>
+#include <types.hpp>
+
+// ==========================================
+// ==========================================
+/* Several advection problems sharing n1, stacked along n0 (each problem
+brings its n0 velocities, all have the same n2) or along n2 (each brings its
+n2 lines, all have the same n0). Owns the device tables read by
+BatchedAdvectionSolver, one bkma_run on the stacked buffer updates every
+problem by one of its own time steps. */
+class AdvectionBatch {
+    sycl::queue q_;
+    std::vector<ADVParams> problems_;
+    BatchAxis axis_;
+    std::vector<size_t> offsets_;   // first line of each problem, total last
+
+    ADVParams *params_ = nullptr;
+    size_t *offsets_dev_ = nullptr;
+    uint32_t *problem_of_ = nullptr;
+
+  public:
+    AdvectionBatch() = delete;
+    AdvectionBatch(const AdvectionBatch &) = delete;
+    AdvectionBatch &operator=(const AdvectionBatch &) = delete;
+
+    AdvectionBatch(sycl::queue q, const std::vector<ADVParams> &problems,
+                   const BatchAxis axis = BatchAxis::D0)
+        : q_(q), problems_(problems), axis_(axis) {
+        if (problems_.empty())
+            throw std::invalid_argument("AdvectionBatch needs a problem");
+
+        const auto &first = problems_.front();
+        offsets_.assign(1, 0);
+        for (const auto &p : problems_) {
+            if (p.n1 != first.n1)
+                throw std::invalid_argument(
+                    "Batched problems must have the same n1");
+            if (axis_ == BatchAxis::D0 && p.n2 != first.n2)
+                throw std::invalid_argument(
+                    "Problems batched along n0 must have the same n2");
+            if (axis_ == BatchAxis::D2 && p.n0 != first.n0)
+                throw std::invalid_argument(
+                    "Problems batched along n2 must have the same n0");
+            offsets_.push_back(offsets_.back() +
+                               (axis_ == BatchAxis::D0 ? p.n0 : p.n2));
+        }
+
+        std::vector<uint32_t> problem_of(offsets_.back());
+        for (size_t p = 0; p < problems_.size(); ++p)
+            for (auto i = offsets_[p]; i < offsets_[p + 1]; ++i)
+                problem_of[i] = p;
+
+        params_ = sycl::malloc_device<ADVParams>(problems_.size(), q_);
+        offsets_dev_ = sycl::malloc_device<size_t>(offsets_.size(), q_);
+        problem_of_ = sycl::malloc_device<uint32_t>(problem_of.size(), q_);
+        if (!params_ || !offsets_dev_ || !problem_of_)
+            throw std::runtime_error("Failed to allocate the problem tables");
+
+        q_.copy(problems_.data(), params_, problems_.size());
+        q_.copy(offsets_.data(), offsets_dev_, offsets_.size());
+        q_.copy(problem_of.data(), problem_of_, problem_of.size());
+        q_.wait();
+    }
+
+    ~AdvectionBatch() {
+        sycl::free(params_, q_);
+        sycl::free(offsets_dev_, q_);
+        sycl::free(problem_of_, q_);
+    }
+
+    [[nodiscard]] inline size_t size() const { return problems_.size(); }
+    [[nodiscard]] inline const ADVParams &problem(const size_t p) const {
+        return problems_[p];
+    }
+
+    // ==========================================
+    [[nodiscard]] inline BatchedAdvectionSolver solver() const {
+        return {params_, offsets_dev_, problem_of_, axis_};
+    }
+
+    // ==========================================
+    /* Params of the stacked buffer, to plan bkma_run on it */
+    [[nodiscard]] ADVParams params() const {
+        ADVParams stacked = problems_.front();
+        if (axis_ == BatchAxis::D0)
+            stacked.n0 = offsets_.back();
+        else
+            stacked.n2 = offsets_.back();
+        return stacked;
+    }
+
+    // ==========================================
+    /* Initial condition of every problem, as fill_buffer_adv */
+    void fill(span3d_t data) {
+        const auto solver = this->solver();
+        sycl::range r3d(data.extent(0), data.extent(1), data.extent(2));
+        q_.submit([&](sycl::handler &cgh) {
+              cgh.parallel_for(r3d, [=](auto i) {
+                  const size_t i0 = i[0];
+                  const size_t i1 = i[1];
+                  const size_t i2 = i[2];
+
+                  const auto p =
+                      solver.problem_of[solver.axis == BatchAxis::D0 ? i0
+                                                                     : i2];
+                  const auto &prm = solver.params[p];
+                  real_t x = prm.minRealX + i1 * prm.dx;
+                  data(i0, i1, i2) = sycl::sin(4 * x * M_PI);
+              });      // end parallel_for
+          }).wait();   // end q.submit
+    }   // end fill
+
+    // ==========================================
+    /* L1 error of each problem against the exact solution after n_steps of
+    its own dt, as validate_result_adv */
+    [[nodiscard]] std::vector<real_t> errors(span3d_t data,
+                                             const size_t n_steps) {
+        const auto n0 = data.extent(0);
+        const auto n1 = data.extent(1);
+        const auto n2 = data.extent(2);
+        std::vector<real_t> host(n0 * n1 * n2);
+        q_.copy(data.data_handle(), host.data(), host.size()).wait();
+
+        std::vector<real_t> errors(size(), 0);
+        for (size_t i0 = 0; i0 < n0; ++i0)
+            for (size_t i1 = 0; i1 < n1; ++i1)
+                for (size_t i2 = 0; i2 < n2; ++i2) {
+                    const auto ia = axis_ == BatchAxis::D0 ? i0 : i2;
+                    size_t p = 0;
+                    while (ia >= offsets_[p + 1])
+                        ++p;
+                    const auto &prm = problems_[p];
+                    const auto iv = axis_ == BatchAxis::D0 ? i0 - offsets_[p]
+                                                           : i0;
+
+                    const real_t x = prm.minRealX + i1 * prm.dx;
+                    const real_t v = prm.minRealVx + iv * prm.dvx;
+                    const real_t t = n_steps * prm.dt;
+                    const auto f = host[(i0 * n1 + i1) * n2 + i2];
+                    const auto exact = std::sin(4 * M_PI * (x - v * t));
+                    errors[p] += std::fabs(f - exact);
+                }
+
+        for (size_t p = 0; p < size(); ++p)
+            errors[p] /= problems_[p].n0 * problems_[p].n1 * problems_[p].n2;
+        return errors;
+    }   // end errors
+};   // end class AdvectionBatch
@@ -0,0 +1,214 @@
+#pragma once
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sycl/sycl.hpp>
+#include <bkma.hpp>
+
+// ==========================================
+// ==========================================
+/* Everything bkma_run will do for a problem, as decided by the planners */
+struct ExecutionPlan {
+    std::string impl;
+    size_t n0, n1, n2, nw;
+    BkmaOptimParams optim_params;
+    size_t local_mem_bytes;      // local scratch of one work-group
+    size_t device_local_mem;     // local memory available per work-group
+    size_t global_lines;         // lines of a batch using the global scratch
+    size_t global_scratch_bytes; // global scratch of one batch
+    double traffic_bytes;        // expected global traffic per iteration
+    size_t steps_in_flight;      // time steps enqueued ahead of the host
+    std::vector<std::string> clamps;
+};
+
+// ==========================================
+// ==========================================
+/* Builds the plan of optim_params and lists the decisions that rewrote the
+requested sizes: the heuristic adjusted to local memory, the batches imposed
+by the device or the scratch cap, the sizes clamped inside a launch. */
+template <typename Params>
+ExecutionPlan
+make_execution_plan(sycl::queue &q, const Params &params,
+                    const BkmaOptimParams &optim_params,
+                    const std::string &impl, const size_t window,
+                    const size_t steps_in_flight = 1) {
+    ExecutionPlan plan;
+    plan.impl = impl;
+    plan.n0 = params.n0;
+    plan.n1 = params.n1;
+    plan.n2 = params.n2;
+    plan.nw = params.n1 - (window - 1);
+    plan.optim_params = optim_params;
+    plan.steps_in_flight = steps_in_flight;
+
+    const auto &p = optim_params;
+    const auto &dev = DeviceProfile::get(q.get_device());
+    const auto b0 = p.dispatch_d0.batch_size_;
+    const auto b2 = p.dispatch_d2.batch_size_;
+
+    plan.device_local_mem = dev.local_mem_size;
+    /* Local memory of a work-group as declared by the implementation */
+    plan.local_mem_bytes = 0;
+    for (auto i : ALL_IMPLS)
+        if (impl_to_string(i) == impl)
+            plan.local_mem_bytes = visit_impl(i, [&](auto I) {
+                return ImplTraits<decltype(I)::value>::local_bytes(
+                    p, plan.n1, plan.nw);
+            });
+    plan.global_lines = BkmaContext::global_lines0(p) * b2;
+    plan.global_scratch_bytes = plan.global_lines * plan.nw * sizeof(real_t);
+
+    /* Data read and written once, global lines also go through the scratch */
+    const auto n_lines = static_cast<double>(plan.n0 * plan.n2);
+    const auto global_fraction =
+        static_cast<double>(plan.global_lines) / (b0 * b2);
+    plan.traffic_bytes =
+        n_lines * sizeof(real_t) *
+        (plan.n1 + plan.nw + global_fraction * 2 * plan.nw);
+
+    /* Rewrites of the pref_wg_size heuristic */
+    WorkItemDispatch ideal;
+    ideal.set_ideal_sizes(params.pref_wg_size, plan.n0, plan.n1, plan.n2);
+    auto adjusted = ideal;
+    adjusted.adjust_sizes_mem_limit(dev.local_mem_size / sizeof(real_t),
+                                    plan.n1);
+    auto sizes = [](size_t w0, size_t w1, size_t w2) {
+        std::ostringstream oss;
+        oss << "(" << w0 << ", " << w1 << ", " << w2 << ")";
+        return oss.str();
+    };
+
+    if (ideal.size() != params.pref_wg_size)
+        plan.clamps.push_back("set_ideal_sizes: pref_wg_size " +
+                              std::to_string(params.pref_wg_size) +
+                              " became " + std::to_string(ideal.size()) +
+                              " work-items for this shape");
+    if (adjusted.w1_ != ideal.w1_ || adjusted.w2_ != ideal.w2_ ||
+        adjusted.w0_ != ideal.w0_)
+        plan.clamps.push_back(
+            "adjust_sizes_mem_limit: w " +
+            sizes(ideal.w0_, ideal.w1_, ideal.w2_) + " rewritten to " +
+            sizes(adjusted.w0_, adjusted.w1_, adjusted.w2_) +
+            " to fit local memory");
+    if (p.w0 != adjusted.w0_ || p.w1 != adjusted.w1_ ||
+        p.w2 != adjusted.w2_)
+        plan.clamps.push_back("tuning: w " +
+                              sizes(adjusted.w0_, adjusted.w1_, adjusted.w2_) +
+                              " of the heuristic replaced by " +
+                              sizes(p.w0, p.w1, p.w2));
+    if (plan.n1 * sizeof(real_t) > dev.local_mem_size)
+        plan.clamps.push_back("a line of " + std::to_string(plan.n1) +
+                              " elements does not fit in local memory");
+    if (plan.local_mem_bytes > dev.local_mem_size)
+        plan.clamps.push_back("local scratch of a work-group exceeds the "
+                              "device local memory");
+    if (p.w0 * p.w1 * p.w2 > dev.max_wg_size)
+        plan.clamps.push_back("work-group larger than the device maximum " +
+                              std::to_string(dev.max_wg_size));
+
+    /* Decisions of the batch planner and of the kernels */
+    if (p.dispatch_d0.n_batch_ > 1 || p.dispatch_d2.n_batch_ > 1)
+        plan.clamps.push_back(
+            "plan_batchs: split in " + std::to_string(p.dispatch_d0.n_batch_) +
+            " x " + std::to_string(p.dispatch_d2.n_batch_) +
+            " batches by the launch limits or the scratch cap");
+    if (p.w0 * p.wg_dispatch.s0_ > p.dispatch_d0.last_batch_size_ ||
+        p.w2 * p.wg_dispatch.s2_ > p.dispatch_d2.last_batch_size_)
+        plan.clamps.push_back("last batch smaller than w*s, w0/w2 and s0/s2 "
+                              "are clamped in its launch");
+    if (p.mem_space == MemorySpace::Hybrid) {
+        const auto kd = dispatch_kernels(b0, p.percent_loc);
+        if (kd.k_local_ % p.w0 != 0)
+            plan.clamps.push_back("hybrid: local lines rounded down to a "
+                                  "multiple of w0");
+    }
+
+    return plan;
+}   // end make_execution_plan
+
+// ==========================================
+// ==========================================
+inline void
+print_plan(std::ostream &os, const ExecutionPlan &plan) {
+    const auto &p = plan.optim_params;
+    const auto &d0 = p.dispatch_d0;
+    const auto &d2 = p.dispatch_d2;
+
+    os << "Execution plan (" << plan.impl << ")\n";
+    os << "  shape       : " << plan.n0 << " x " << plan.n1 << " x "
+       << plan.n2 << " (nw = " << plan.nw << ")\n";
+    os << "  batchs d0   : " << d0.n_batch_ << " of " << d0.batch_size_
+       << " (last " << d0.last_batch_size_ << ")\n";
+    os << "  batchs d2   : " << d2.n_batch_ << " of " << d2.batch_size_
+       << " (last " << d2.last_batch_size_ << ")\n";
+    os << "  w0, w1, w2  : " << p.w0 << ", " << p.w1 << ", " << p.w2 << "\n";
+    os << "  s0, s2      : " << p.wg_dispatch.s0_ << ", "
+       << p.wg_dispatch.s2_ << "\n";
+    os << "  g0, g2      : " << p.wg_dispatch.g0_ << ", "
+       << p.wg_dispatch.g2_ << "\n";
+    os << "  mem_space   : " << mem_space_to_string(p.mem_space);
+    if (p.mem_space == MemorySpace::Hybrid)
+        os << " (percent_loc " << p.percent_loc << ")";
+    os << "\n";
+    os << "  local/wg    : " << plan.local_mem_bytes << " B of "
+       << plan.device_local_mem << " B\n";
+    os << "  scratch     : " << plan.global_scratch_bytes << " B ("
+       << plan.global_lines << " lines per batch)\n";
+    os << "  in_flight   : " << p.batchs_in_flight << " batchs, "
+       << plan.steps_in_flight << " steps\n";
+    os << "  traffic/it  : " << plan.traffic_bytes / 1e9 << " GB\n";
+    for (const auto &c : plan.clamps)
+        os << "  clamp       : " << c << "\n";
+    os << std::endl;
+}   // end print_plan
+
+// ==========================================
+// ==========================================
+inline void
+print_plan_json(std::ostream &os, const ExecutionPlan &plan) {
+    const auto &p = plan.optim_params;
+    auto batchs = [](const BatchConfig1D &b) {
+        std::ostringstream oss;
+        oss << "{\"n_batch\": " << b.n_batch_
+            << ", \"batch_size\": " << b.batch_size_
+            << ", \"last_batch_size\": " << b.last_batch_size_ << "}";
+        return oss.str();
+    };
+
+    os << "{\"impl\": \"" << plan.impl << "\", \"n0\": " << plan.n0
+       << ", \"n1\": " << plan.n1 << ", \"n2\": " << plan.n2
+       << ", \"nw\": " << plan.nw
+       << ", \"dispatch_d0\": " << batchs(p.dispatch_d0)
+       << ", \"dispatch_d2\": " << batchs(p.dispatch_d2)
+       << ", \"w\": [" << p.w0 << ", " << p.w1 << ", " << p.w2 << "]"
+       << ", \"s\": [" << p.wg_dispatch.s0_ << ", " << p.wg_dispatch.s2_
+       << "], \"g\": [" << p.wg_dispatch.g0_ << ", " << p.wg_dispatch.g2_
+       << "], \"mem_space\": \"" << mem_space_to_string(p.mem_space)
+       << "\", \"percent_loc\": " << p.percent_loc
+       << ", \"batchs_in_flight\": " << p.batchs_in_flight
+       << ", \"steps_in_flight\": " << plan.steps_in_flight
+       << ", \"local_mem_bytes\": " << plan.local_mem_bytes
+       << ", \"device_local_mem\": " << plan.device_local_mem
+       << ", \"global_scratch_bytes\": " << plan.global_scratch_bytes
+       << ", \"traffic_bytes\": " << plan.traffic_bytes << ", \"clamps\": [";
+    for (size_t i = 0; i < plan.clamps.size(); ++i)
+        os << (i > 0 ? ", " : "") << "\"" << plan.clamps[i] << "\"";
+    os << "]}" << std::endl;
+}   // end print_plan_json
+
+// ==========================================
+// ==========================================
+/* Prints the plan according to the [io] explain_plan key: none, text or
+json */
+inline void
+explain_plan(std::ostream &os, const ExecutionPlan &plan,
+             const std::string &format) {
+    if (format == "text")
+        print_plan(os, plan);
+    else if (format == "json")
+        print_plan_json(os, plan);
+    else if (format != "none")
+        throw std::invalid_argument("explain_plan should be: none, text or "
+                                    "json, got " + format);
+}   // end explain_plan
@@ -2,12 +2,18 @@
 #include <algorithm>
 #include <string>
 #include <cctype>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <vector>
 #include <types.hpp>
 #include <sycl/sycl.hpp>
 #include <bkma.hpp>
 
 static constexpr auto error_str =
-    "Should be: {BasicRange, NDRange, AdaptiveWg}";
+    "Should be: {auto, BasicRange, NDRange, AdaptiveWg, Persistent}";
 
 // ==========================================
 // ==========================================
@@ -18,7 +24,7 @@ str2int(const char *str, int h = 0) noexcept {
 
 // ==========================================
 // ==========================================
-[[nodiscard]] std::string
+[[nodiscard]] inline std::string
 to_lowercase(const std::string &input) {
     std::string result = input;
     std::transform(result.begin(), result.end(), result.begin(),
@@ -28,45 +34,137 @@ to_lowercase(const std::string &input) {
 
 // ==========================================
 // ==========================================
-template <typename Solver>
-std::function<
-    sycl::event(sycl::queue &, span3d_t, const Solver &, BkmaOptimParams,
-                span3d_t)> inline impl_selector(const std::string &impl_name) {
-
+/* The [impl] kernelImpl key, auto is returned as std::nullopt */
+[[nodiscard]] inline std::optional<BkmaImpl>
+impl_from_string(const std::string &impl_name) {
     auto impl = to_lowercase(impl_name);
     switch (str2int(impl.data())) {
-    // case str2int("basicrange"):
-    //     return &bkma_run<Solver, BkmaImpl::BasicRange>;
+    case str2int("auto"):
+        return std::nullopt;
+    case str2int("basicrange"):
+        return BkmaImpl::BasicRange;
     case str2int("ndrange"):
-        return &bkma_run<Solver, BkmaImpl::NDRange>;
+        return BkmaImpl::NDRange;
     case str2int("adaptivewg"):
-        return &bkma_run<Solver, BkmaImpl::AdaptiveWg>;
+        return BkmaImpl::AdaptiveWg;
+    case str2int("persistent"):
+        return BkmaImpl::Persistent;
     default:
         auto str =
             impl_name + " is not a valid implementation name.\n" + error_str;
         throw std::runtime_error(str);
     }
+}   // end impl_from_string
+
+// ==========================================
+// ==========================================
+template <typename Solver>
+using BkmaRunFunction = sycl::event (*)(sycl::queue &, span3d_t,
+                                        const Solver &, BkmaOptimParams,
+                                        span3d_t,
+                                        const std::vector<sycl::event> &);
+
+/* Plain function pointer to bkma_run. Loops that call it every step should
+rather instantiate bkma_run through visit_impl. */
+template <typename Solver>
+[[nodiscard]] inline BkmaRunFunction<Solver>
+impl_selector(const BkmaImpl impl) {
+    return visit_impl(impl, [](auto I) -> BkmaRunFunction<Solver> {
+        return &bkma_run<Solver, decltype(I)::value>;
+    });
 }
 
-// bkma_run<ConvSolver, BkmaImpl::AdaptiveWg>(Q, warmup_data, solver,
-//     optim_params)
+template <typename Solver>
+[[nodiscard]] inline BkmaRunFunction<Solver>
+impl_selector(const std::string &impl_name) {
+    auto impl = impl_from_string(impl_name);
+    if (!impl)
+        throw std::runtime_error("auto is not a single implementation, "
+                                 "pick one with fastest_impl");
+    return impl_selector<Solver>(*impl);
+}
 
-// sref::unique_ref<IAdvectorX>
-// kernel_impl_factory(const sycl::queue &q, const ADVParamsNonCopyable &params,
-//                     AdvectionSolver &s) {
-//     std::string kernel_name(params.kernelImpl.begin(),
-//     params.kernelImpl.end());
+// ==========================================
+// ==========================================
+/* Implementations able to run optim_params on the problem */
+[[nodiscard]] inline std::vector<BkmaImpl>
+eligible_impls(const sycl::device &d, const BkmaOptimParams &optim_params,
+               const size_t n1, const size_t window,
+               const bool line_passes = false) {
+    const auto &dev = DeviceProfile::get(d);
+    std::vector<BkmaImpl> impls;
+    for (auto impl : ALL_IMPLS)
+        if (impl_unsupported(impl, dev, optim_params, n1, window,
+                             line_passes)
+                .empty())
+            impls.push_back(impl);
+    return impls;
+}   // end eligible_impls
+
+// ==========================================
+// ==========================================
+/* Throws if impl cannot run optim_params on the problem */
+inline void
+check_impl(sycl::queue &q, const BkmaImpl impl,
+           const BkmaOptimParams &optim_params, const size_t n1,
+           const size_t window, const bool line_passes = false) {
+    const auto reason =
+        impl_unsupported(impl, DeviceProfile::get(q.get_device()),
+                         optim_params, n1, window, line_passes);
+    if (!reason.empty())
+        throw std::invalid_argument(reason);
+}   // end check_impl
+
+// ==========================================
+// ==========================================
+/* Benchmarks the eligible implementations with run(impl) and returns the
+fastest. run must not depend on the content of the buffer it updates since
+it is called many times. Throws with the error of each implementation if
+none of them runs. */
+template <typename RunFunction>
+BkmaImpl
+fastest_impl(sycl::queue &q, const BkmaOptimParams &optim_params,
+             const size_t n1, const size_t window, const bool line_passes,
+             RunFunction &&run, const size_t n_reps = 3) {
+    const auto impls = eligible_impls(q.get_device(), optim_params, n1,
+                                      window, line_passes);
+    if (impls.empty())
+        throw std::runtime_error("No implementation supports this problem");
+
+    std::optional<BkmaImpl> best;
+    double best_time = std::numeric_limits<double>::max();
+    std::string errors;
+    for (auto impl : impls) {
+        try {
+            /* The first run includes the JIT compilation. Asynchronous
+            kernel errors are thrown by wait_and_throw. */
+            run(impl).wait_and_throw();
+            auto start = std::chrono::high_resolution_clock::now();
+            for (size_t i = 0; i < n_reps; ++i)
+                run(impl).wait_and_throw();
+            auto end = std::chrono::high_resolution_clock::now();
+
+            const std::chrono::duration<double> elapsed = end - start;
+            const auto seconds = elapsed.count() / n_reps;
+            std::cout << "  " << impl_to_string(impl) << ": " << seconds
+                      << " s\n";
+            if (seconds < best_time) {
+                best_time = seconds;
+                best = impl;
+            }
+        } catch (const sycl::exception &e) {
+            /* Rejected by the device */
+            errors += "\n  " + impl_to_string(impl) + ": " + e.what();
+        } catch (const std::invalid_argument &e) {
+            /* Rejected by bkma_run for this solver */
+            errors += "\n  " + impl_to_string(impl) + ": " + e.what();
+        }
+    }
 
-//     switch (str2int(kernel_name.data())) {
-//     case str2int("BasicRange"):
-//         return sref::make_unique<AdvX::BasicRange>(s, q);
-//     case str2int("NDRange"):
-//         return sref::make_unique<AdvX::NDRange>();
-//     case str2int("AdaptiveWg"):
-//         return sref::make_unique<AdvX::AdaptiveWg>(s, q);
-//     default:
-//         auto str = kernel_name + " is not a valid kernel name.\n" +
-//         error_str; throw std::runtime_error(str);
-//     }
-// }
+    if (!best)
+        throw std::runtime_error("Every implementation failed:" + errors);
 
+    std::cout << "Selected implementation: " << impl_to_string(*best) << "\n"
+              << std::endl;
+    return *best;
+}   // end fastest_impl
@@ -1,6 +1,8 @@
 #pragma once
 #include <AdvectionParams.hpp>
+#include <algorithm>
 #include <cmath>
+#include <exception>
 #include <sycl/sycl.hpp>
 #include <bkma.hpp>
 
@@ -28,7 +30,17 @@ pick_device(bool run_on_gpu) {
 
 // ==========================================
 // ==========================================
-void
+/* Async handler of the queues: rethrows the first asynchronous error, so
+that wait_and_throw reports a failed kernel to its caller */
+inline void
+rethrow_async_errors(sycl::exception_list errors) {
+    for (auto &e : errors)
+        std::rethrow_exception(e);
+} //end rethrow_async_errors
+
+// ==========================================
+// ==========================================
+inline void
 fill_buffer_adv(sycl::queue &q, span3d_t &data, const ADVParams &params) {
     const auto n0 = params.n0, n1 = params.n1, n2 = params.n2;
 
@@ -47,7 +59,7 @@ fill_buffer_adv(sycl::queue &q, span3d_t &data, const ADVParams &params) {
 
 // ==========================================
 // ==========================================
-void
+inline void
 fill_buffer_conv1d(sycl::queue &q, span3d_t &data, span3d_t &warmup_data,
                    span3d_t &weight, span1d_t &bias) {
 
@@ -73,30 +85,92 @@ fill_buffer_conv1d(sycl::queue &q, span3d_t &data, span3d_t &warmup_data,
 
 // ==========================================
 // ==========================================
+/* Completes the work-item sizes and sequential sizes with the batch
+decomposition allowed by the device and by params.max_scratch_mb */
+template <typename Params>
+BkmaOptimParams
+make_bkma_params(sycl::queue &q, const Params &params, const size_t w0,
+                 const size_t w1, const size_t w2, const size_t s0,
+                 const size_t s2, const MemorySpace mem_space) {
+    WorkGroupDispatch wg_dispatch;
+    wg_dispatch.s0_ = s0;
+    wg_dispatch.s2_ = s2;
+
+    auto dev = DeviceProfile::get(q.get_device());
+    if (params.max_scratch_mb > 0)
+        dev.max_alloc_elems =
+            std::min(dev.max_alloc_elems,
+                     params.max_scratch_mb * 1024 * 1024 / sizeof(real_t));
+
+    auto [dispatch_d0, dispatch_d2] = plan_batchs(
+        dev, params.n0, params.n2, w0, w2, wg_dispatch, mem_space,
+        params.n1);
+
+    wg_dispatch.set_num_work_groups(params.n0, params.n2, dispatch_d0.n_batch_,
+                                    dispatch_d2.n_batch_, w0, w2);
+
+    return BkmaOptimParams{dispatch_d0, dispatch_d2, w0,        w1,
+                           w2,          wg_dispatch, mem_space,
+                           params.batchs_in_flight};
+} //end make_bkma_params
+
+// ==========================================
+// ==========================================
+/* line_passes: the solver has line passes (HasLinePasses), its lines are
+staged in local memory with a second tile of the same size */
 template <typename Params>
-BkmaOptimParams create_optim_params(sycl::queue &q, const Params &params) {
+BkmaOptimParams create_optim_params(sycl::queue &q, const Params &params,
+                                    const bool line_passes = false) {
     const auto n0 = params.n0;
     const auto n1 = params.n1;
     const auto n2 = params.n2;
+    const auto staged_n1 = line_passes ? 2 * n1 : n1;
 
+    const auto &dev = DeviceProfile::get(q.get_device());
     WorkItemDispatch wi_dispatch;
     wi_dispatch.set_ideal_sizes(params.pref_wg_size, n0, n1, n2);
-    auto max_elem_local_mem =
-        q.get_device().get_info<sycl::info::device::local_mem_size>() /
-        sizeof(real_t);
-    wi_dispatch.adjust_sizes_mem_limit(max_elem_local_mem, n1);
+    wi_dispatch.adjust_sizes_mem_limit(dev.local_mem_size / sizeof(real_t),
+                                       staged_n1);
 
-    WorkGroupDispatch wg_dispatch;
-    wg_dispatch.set_num_work_groups(n0, n2, params.seq_size0, params.seq_size2,
-                                    wi_dispatch.w0_, wi_dispatch.w2_);
-
-    /* TODO : here compute the number of batchs */
-    return BkmaOptimParams{
-        {1, n0, n0},         // BatchConfig1D dispatch_d0
-        {1, n2, n2},         // BatchConfig1D dispatch_d2
-        wi_dispatch.w0_,     // size_t w0
-        wi_dispatch.w1_,     // size_t w1
-        wi_dispatch.w2_,     // size_t w2
-        wg_dispatch,         // WorkGroupDispatch wg_disp
-        MemorySpace::Local}; /* TODO : change this depending on params*/
+    /* percent_loc of the lines use local scratch, a negative value lets the
+    occupancy decide. Without room in local memory everything is global. */
+    auto const auto_percent_loc = hybrid_local_fraction(
+        dev, wi_dispatch.w0_, wi_dispatch.w1_, wi_dispatch.w2_, staged_n1);
+    auto const percent_loc =
+        params.percent_loc < 0 || auto_percent_loc == 0
+            ? auto_percent_loc
+            : std::min(params.percent_loc, 1.f);
+
+    auto const mem_space = percent_loc >= 1   ? MemorySpace::Local
+                           : percent_loc <= 0 ? MemorySpace::Global
+                                              : MemorySpace::Hybrid;
+
+    auto optim_params = make_bkma_params(
+        q, params, wi_dispatch.w0_, wi_dispatch.w1_, wi_dispatch.w2_,
+        params.seq_size0, params.seq_size2, mem_space);
+    optim_params.percent_loc = percent_loc;
+    return optim_params;
 } //end create_optim_params
+
+// ==========================================
+// ==========================================
+/* BkmaOptimParams predicted by the analytical cost model, instead of the
+pref_wg_size/seq_size heuristic */
+template <typename Params>
+BkmaOptimParams
+model_optim_params(sycl::queue &q, const Params &params, const size_t window,
+                   const bool allow_global_scratch = false) {
+    const auto n0 = params.n0;
+    const auto n1 = params.n1;
+    const auto n2 = params.n2;
+
+    /* Only the extents and strides of the span are used */
+    span3d_t shape(nullptr, n0, n1, n2);
+    const auto &dev = DeviceProfile::get(q.get_device());
+    auto c = plan_dispatch(dev, shape, window, allow_global_scratch);
+
+    auto optim_params =
+        make_bkma_params(q, params, c.w0, c.w1, c.w2, c.s0, c.s2, c.mem_space);
+    optim_params.percent_loc = c.mem_space == MemorySpace::Local ? 1.f : 0.f;
+    return optim_params;
+} //end model_optim_params
@@ -0,0 +1,479 @@
+#pragma once
+#include <AdvectionParams.hpp>
+#include <BatchedAdvectionSolver.hpp>
+#include <ConvSolver.hpp>
+#include <Conv1dParams.hpp>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <sycl/sycl.hpp>
+#include <batched_problems.hpp>
+#include <bkma.hpp>
+#include <init.hpp>
+
+enum class JobKind { Advection, Conv1d };
+
+// ==========================================
+// ==========================================
+/* One request of a client: the job kind followed by key=value pairs on a
+single line, for instance
+    advection n0=64 n1=1024 n2=1 maxIter=100 dt=0.001 maxRealVx=2
+    conv1d n0=8 n2=16 length=1024 channels=3 k=3
+Unset keys keep the defaults of ADVParams and Conv1dParams. */
+struct Job {
+    JobKind kind;
+    ADVParams adv;
+    Conv1dParams conv;
+    std::promise<std::string> reply;
+
+    [[nodiscard]] inline size_t cells() const {
+        return kind == JobKind::Advection ? adv.n0 * adv.n1 * adv.n2
+                                          : conv.n0 * conv.n1 * conv.n2;
+    }
+
+    /* Jobs that can share a launch: stacked along n0, they must agree on
+    everything but n0 and, for advection, the physical parameters */
+    [[nodiscard]] inline bool compatible(const Job &other) const {
+        if (kind != other.kind)
+            return false;
+        if (kind == JobKind::Advection)
+            return adv.n1 == other.adv.n1 && adv.n2 == other.adv.n2 &&
+                   adv.maxIter == other.adv.maxIter;
+        return conv.length == other.conv.length &&
+               conv.channel_in == other.conv.channel_in &&
+               conv.k == other.conv.k && conv.n2 == other.conv.n2;
+    }
+};
+
+// ==========================================
+// ==========================================
+[[nodiscard]] inline std::unique_ptr<Job>
+parse_job(const std::string &line) {
+    std::istringstream iss(line);
+    std::string kind;
+    iss >> kind;
+
+    auto job = std::make_unique<Job>();
+    if (kind == "advection")
+        job->kind = JobKind::Advection;
+    else if (kind == "conv1d")
+        job->kind = JobKind::Conv1d;
+    else
+        throw std::invalid_argument(
+            "job should be: advection or conv1d, got " + kind);
+
+    auto &adv = job->adv;
+    adv.seq_size0 = adv.seq_size2 = 1;
+    auto &conv = job->conv;
+    conv.n0 = conv.n2 = 1;
+    size_t channels = conv.channel_in, k = conv.k;
+
+    const bool is_adv = job->kind == JobKind::Advection;
+    const std::map<std::string, size_t *> sizes =
+        is_adv ? std::map<std::string, size_t *>{{"n0", &adv.n0},
+                                                 {"n1", &adv.n1},
+                                                 {"n2", &adv.n2},
+                                                 {"maxIter", &adv.maxIter}}
+               : std::map<std::string, size_t *>{{"n0", &conv.n0},
+                                                 {"n2", &conv.n2},
+                                                 {"length", &conv.length},
+                                                 {"channels", &channels},
+                                                 {"k", &k}};
+    std::map<std::string, real_t *> reals;
+    if (is_adv)
+        reals = {{"dt", &adv.dt},
+                 {"minRealX", &adv.minRealX},
+                 {"maxRealX", &adv.maxRealX},
+                 {"minRealVx", &adv.minRealVx},
+                 {"maxRealVx", &adv.maxRealVx}};
+
+    std::string pair;
+    while (iss >> pair) {
+        const auto eq = pair.find('=');
+        if (eq == std::string::npos)
+            throw std::invalid_argument("expected key=value, got " + pair);
+        const auto key = pair.substr(0, eq);
+        const auto value = pair.substr(eq + 1);
+
+        if (auto it = sizes.find(key); it != sizes.end())
+            *it->second = std::stoul(value);
+        else if (auto it = reals.find(key); it != reals.end())
+            *it->second = std::stod(value);
+        else
+            throw std::invalid_argument("unknown " + kind + " key " + key);
+    }
+
+    adv.update_deltas();
+    conv.channel_in = conv.channel_out = channels;
+    conv.k = k;
+    conv.n1 = conv.length * conv.channel_out;
+    if (conv.length < conv.k)
+        throw std::invalid_argument("conv1d length should be at least k");
+    conv.n_write = conv.compute_output_size(conv.length, conv.k);
+
+    if (job->cells() == 0)
+        throw std::invalid_argument("empty job");
+    return job;
+}   // end parse_job
+
+// ==========================================
+// ==========================================
+/* Jobs waiting for the device. pop_batch hands out the oldest job together
+with the compatible jobs that arrived within the coalescing window. */
+class JobQueue {
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::unique_ptr<Job>> jobs_;
+    bool closed_ = false;
+
+  public:
+    void push(std::unique_ptr<Job> job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (closed_)
+                throw std::runtime_error("service stopped");
+            jobs_.push_back(std::move(job));
+        }
+        cv_.notify_one();
+    }
+
+    /* Pending jobs are answered with an error */
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        for (auto &job : jobs_)
+            job->reply.set_value("error service stopped");
+        jobs_.clear();
+        cv_.notify_all();
+    }
+
+    /* Empty once the queue is closed */
+    [[nodiscard]] std::vector<std::unique_ptr<Job>>
+    pop_batch(const std::chrono::microseconds window,
+              const size_t max_cells) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [&] { return closed_ || !jobs_.empty(); });
+        if (closed_)
+            return {};
+
+        /* Gives concurrent clients a chance to join the launch */
+        cv_.wait_for(lock, window, [&] { return closed_; });
+        if (closed_)
+            return {};
+
+        std::vector<std::unique_ptr<Job>> batch;
+        batch.push_back(std::move(jobs_.front()));
+        jobs_.pop_front();
+        auto cells = batch.front()->cells();
+
+        for (auto it = jobs_.begin(); it != jobs_.end();) {
+            if ((*it)->compatible(*batch.front()) &&
+                cells + (*it)->cells() <= max_cells) {
+                cells += (*it)->cells();
+                batch.push_back(std::move(*it));
+                it = jobs_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        return batch;
+    }
+};   // end class JobQueue
+
+// ==========================================
+// ==========================================
+/* Serves advection and conv1d jobs on a Unix socket. The queue, the
+compiled kernels, and the pools of the data, the weights and the scratch
+(one BkmaContext each) stay warm between jobs, and compatible jobs are stacked along n0 into one launch:
+advection jobs through AdvectionBatch, conv1d jobs share their weights.
+Each client sends one line and reads one line back:
+    ok <results> batched=<jobs in the launch>
+    error <message>
+Beyond max_clients connections in progress, a client is answered
+"error busy" right away. */
+class BkmaService {
+    sycl::queue q_;
+    BkmaContext ctx_;
+    JobQueue jobs_;
+    std::chrono::microseconds window_;
+    size_t max_batch_cells_;
+    std::chrono::milliseconds read_timeout_;
+    size_t max_clients_;
+
+    BkmaContext data_;
+    BkmaContext weights_;   // conv1d weights then bias
+
+    std::atomic<bool> stop_{false};
+    int listen_fd_ = -1;
+
+  public:
+    BkmaService() = delete;
+    BkmaService(const BkmaService &) = delete;
+    BkmaService &operator=(const BkmaService &) = delete;
+
+    /* A client has read_timeout to send its request. The queue should have
+    an async handler rethrowing the kernel errors, see rethrow_async_errors,
+    so that they are answered to the clients of the launch. */
+    BkmaService(sycl::queue q, const std::chrono::microseconds window,
+                const size_t max_batch_cells,
+                const std::chrono::milliseconds read_timeout =
+                    std::chrono::seconds(10),
+                const size_t max_clients = 64)
+        : q_(q), ctx_(q), window_(window), max_batch_cells_(max_batch_cells),
+          read_timeout_(read_timeout), max_clients_(max_clients), data_(q),
+          weights_(q) {}
+
+    // ==========================================
+    /* Data buffer of the batch, grown only when a larger batch comes */
+    [[nodiscard]] span3d_t buffer(const size_t n0, const size_t n1,
+                                  const size_t n2) {
+        return span3d_t(data_.pool(n0 * n1 * n2), n0, n1, n2);
+    }
+
+    // ==========================================
+    /* One tiny job of each kind, so that the kernels are compiled before
+    the first client comes */
+    void warmup() {
+        std::vector<std::unique_ptr<Job>> batch;
+        batch.push_back(parse_job("advection n0=4 n1=64 n2=1 maxIter=1"));
+        run_batch(batch);
+        batch.clear();
+        batch.push_back(parse_job("conv1d n0=1 n2=1 length=64 channels=1"));
+        run_batch(batch);
+    }
+
+    // ==========================================
+    void run_batch(std::vector<std::unique_ptr<Job>> &batch) {
+        try {
+            if (batch.front()->kind == JobKind::Advection)
+                run_advection(batch);
+            else
+                run_conv1d(batch);
+        } catch (const std::exception &e) {
+            for (auto &job : batch)
+                job->reply.set_value(std::string("error ") + e.what());
+        }
+    }
+
+    // ==========================================
+    void run_advection(std::vector<std::unique_ptr<Job>> &batch) {
+        std::vector<ADVParams> problems;
+        for (const auto &job : batch)
+            problems.push_back(job->adv);
+
+        AdvectionBatch problem_batch(q_, problems, BatchAxis::D0);
+        const auto params = problem_batch.params();
+        auto data = buffer(params.n0, params.n1, params.n2);
+        problem_batch.fill(data);
+
+        const auto solver = problem_batch.solver();
+        const auto nw = params.n1 - (solver.window() - 1);
+        auto optim_params = create_optim_params<ADVParams>(q_, params);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        std::vector<sycl::event> deps;
+        for (size_t t = 0; t < params.maxIter; ++t)
+            deps = {bkma_run<BatchedAdvectionSolver, BkmaImpl::AdaptiveWg>(
+                q_, data, solver, optim_params, ctx_.scratch(optim_params, nw),
+                deps)};
+        q_.wait_and_throw();
+        auto end = std::chrono::high_resolution_clock::now();
+        const std::chrono::duration<double> seconds = end - start;
+
+        const auto errors = problem_batch.errors(data, params.maxIter);
+        for (size_t i = 0; i < batch.size(); ++i) {
+            std::ostringstream oss;
+            oss << "ok l1_error=" << errors[i] << " seconds="
+                << seconds.count() << " batched=" << batch.size();
+            batch[i]->reply.set_value(oss.str());
+        }
+    }   // end run_advection
+
+    // ==========================================
+    void run_conv1d(std::vector<std::unique_ptr<Job>> &batch) {
+        Conv1dParams params = batch.front()->conv;
+        params.n0 = 0;
+        for (const auto &job : batch)
+            params.n0 += job->conv.n0;
+
+        const auto n1 = params.n1, n2 = params.n2;
+        const auto k = params.k, channels = params.channel_in;
+        auto data = buffer(params.n0, n1, n2);
+        const auto n_weights = k * channels * channels;
+        auto *weights = weights_.pool(n_weights + channels);
+        span3d_t weight(weights, k, channels, channels);
+        span1d_t bias(weights + n_weights, channels);
+        q_.fill(data.data_handle(), real_t(7.3), params.n0 * n1 * n2);
+        q_.fill(weight.data_handle(), real_t(1.5), n_weights);
+        q_.fill(bias.data_handle(), real_t(1.0), channels);
+        q_.wait_and_throw();
+
+        ConvSolver solver{weight, bias, k, channels, params.length};
+        const auto nw = n1 - (solver.window() - 1);
+        auto optim_params = create_optim_params<Conv1dParams>(q_, params);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        bkma_run<ConvSolver, BkmaImpl::AdaptiveWg>(
+            q_, data, solver, optim_params, ctx_.scratch(optim_params, nw));
+        q_.wait_and_throw();
+        auto end = std::chrono::high_resolution_clock::now();
+        const std::chrono::duration<double> seconds = end - start;
+
+        std::vector<real_t> host(params.n0 * n1 * n2);
+        q_.copy(data.data_handle(), host.data(), host.size()).wait();
+
+        /* Mean of the outputs of each job, lines are contiguous along n0 */
+        size_t i0 = 0;
+        for (auto &job : batch) {
+            double sum = 0;
+            for (size_t j0 = i0; j0 < i0 + job->conv.n0; ++j0)
+                for (size_t iw = 0; iw < nw; ++iw)
+                    for (size_t i2 = 0; i2 < n2; ++i2)
+                        sum += host[(j0 * n1 + iw) * n2 + i2];
+            i0 += job->conv.n0;
+
+            std::ostringstream oss;
+            oss << "ok mean=" << sum / (job->conv.n0 * nw * n2)
+                << " seconds=" << seconds.count()
+                << " batched=" << batch.size();
+            job->reply.set_value(oss.str());
+        }
+    }   // end run_conv1d
+
+    // ==========================================
+    /* Blocks until a client sends "shutdown" */
+    void serve(const std::string &socket_path) {
+        listen_fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listen_fd_ < 0)
+            throw std::runtime_error(std::string("socket: ") +
+                                     std::strerror(errno));
+
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (socket_path.size() >= sizeof(addr.sun_path))
+            throw std::invalid_argument("socket path too long");
+        std::strcpy(addr.sun_path, socket_path.c_str());
+        unlink(socket_path.c_str());
+        if (bind(listen_fd_, reinterpret_cast<sockaddr *>(&addr),
+                 sizeof(addr)) < 0 ||
+            listen(listen_fd_, SOMAXCONN) < 0)
+            throw std::runtime_error("bind " + socket_path + ": " +
+                                     std::strerror(errno));
+
+        /* A single thread owns the device */
+        std::thread worker([&] {
+            while (true) {
+                auto batch = jobs_.pop_batch(window_, max_batch_cells_);
+                if (batch.empty())
+                    break;
+                run_batch(batch);
+            }
+        });
+
+        /* One thread per connection, joined once it has answered so that
+        only the clients in progress hold a thread, max_clients_ at most */
+        struct Client {
+            std::thread thread;
+            std::shared_ptr<std::atomic<bool>> done;
+        };
+        std::vector<Client> clients;
+        auto join_done = [&clients](const bool all) {
+            for (auto it = clients.begin(); it != clients.end();) {
+                if (all || *it->done) {
+                    it->thread.join();
+                    it = clients.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        };
+
+        while (!stop_) {
+            const int fd = accept(listen_fd_, nullptr, nullptr);
+            if (fd < 0) {
+                if (stop_)
+                    break;
+                continue;
+            }
+            join_done(false);
+            if (clients.size() >= max_clients_) {
+                const std::string busy = "error busy\n";
+                if (write(fd, busy.data(), busy.size()) < 0)
+                    std::cerr << "Failed to answer a client\n";
+                close(fd);
+                continue;
+            }
+
+            /* A client that never ends its line gives up its thread after
+            read_timeout */
+            timeval timeout{};
+            timeout.tv_sec = read_timeout_.count() / 1000;
+            timeout.tv_usec = read_timeout_.count() % 1000 * 1000;
+            setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout,
+                       sizeof(timeout));
+
+            auto done = std::make_shared<std::atomic<bool>>(false);
+            clients.push_back({std::thread([this, fd, done] {
+                                   handle_client(fd);
+                                   *done = true;
+                               }),
+                               done});
+        }
+
+        jobs_.close();
+        worker.join();
+        join_done(true);
+        close(listen_fd_);
+        unlink(socket_path.c_str());
+    }   // end serve
+
+  private:
+    // ==========================================
+    void handle_client(const int fd) {
+        std::string line;
+        char c;
+        ssize_t n_read;
+        while ((n_read = read(fd, &c, 1)) == 1 && c != '\n')
+            line += c;
+
+        std::string reply;
+        if (n_read < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            reply = "error no request within the read timeout";
+        } else if (line == "shutdown") {
+            stop_ = true;
+            shutdown(listen_fd_, SHUT_RDWR);
+            reply = "ok";
+        } else {
+            try {
+                auto job = parse_job(line);
+                auto future = job->reply.get_future();
+                jobs_.push(std::move(job));
+                reply = future.get();
+            } catch (const std::exception &e) {
+                reply = std::string("error ") + e.what();
+            }
+        }
+
+        reply += '\n';
+        if (write(fd, reply.data(), reply.size()) < 0)
+            std::cerr << "Failed to answer a client\n";
+        close(fd);
+    }   // end handle_client
+};   // end class BkmaService
@@ -0,0 +1,201 @@
+#pragma once
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <sycl/sycl.hpp>
+#include <bkma.hpp>
+#include <init.hpp>
+
+// ==========================================
+// ==========================================
+/* Forwards to a solver with i0 shifted by the first line of a slice, so that
+a slice of data is solved as the lines it came from */
+template <class MySolver> struct OffsetSolver {
+    MySolver solver;
+    size_t offset0;
+
+    auto inline window() const { return solver.window(); }
+
+    template <class ArrayLike1D>
+    inline __attribute__((always_inline)) real_t
+    operator()(const ArrayLike1D data, const size_t &i0, const size_t &i1,
+               const size_t &i2) const {
+        return solver(data, i0 + offset0, i1, i2);
+    }
+};
+
+// ==========================================
+// ==========================================
+/* NUMA domains of d as sub-devices, or d itself when it cannot be
+partitioned by affinity domain */
+[[nodiscard]] inline std::vector<sycl::device>
+numa_sub_devices(const sycl::device &d) {
+    using namespace sycl::info;
+    const auto props = d.get_info<device::partition_properties>();
+    const auto domains = d.get_info<device::partition_affinity_domains>();
+
+    const auto by_domain =
+        std::find(props.begin(), props.end(),
+                  partition_property::partition_by_affinity_domain) !=
+        props.end();
+    const auto numa = std::find(domains.begin(), domains.end(),
+                                partition_affinity_domain::numa) !=
+                      domains.end();
+    if (by_domain && numa) {
+        try {
+            return d.create_sub_devices<
+                partition_property::partition_by_affinity_domain>(
+                partition_affinity_domain::numa);
+        } catch (const sycl::exception &) {
+            /* Advertised but refused by the runtime */
+        }
+    }
+    return {d};
+}   // end numa_sub_devices
+
+// ==========================================
+// ==========================================
+/* Devices selected by the [optimization] multi_device key:
+    none : d only
+    numa : the NUMA domains of d
+    all  : every device of the platform of d with the same type */
+[[nodiscard]] inline std::vector<sycl::device>
+select_devices(const sycl::device &d, const std::string &mode) {
+    if (mode == "none")
+        return {d};
+    if (mode == "numa")
+        return numa_sub_devices(d);
+    if (mode == "all")
+        return d.get_platform().get_devices(
+            d.is_gpu() ? sycl::info::device_type::gpu
+                       : sycl::info::device_type::cpu);
+
+    throw std::invalid_argument("multi_device should be: none, numa or all, "
+                                "got " + mode);
+}   // end select_devices
+
+// ==========================================
+// ==========================================
+/* Runs bkma_run on several devices sharing one context. Dimension n0 is
+split in contiguous slices, one per device, each with its own queue,
+BkmaOptimParams and global scratch. Data is allocated as shared USM and
+first touched slice by slice by the device that updates it, so that on a
+multi-socket CPU each slice lives in the NUMA domain that computes it. */
+class BkmaMultiDevice {
+    std::vector<sycl::device> devices_;
+    sycl::context context_;
+    std::vector<sycl::queue> queues_;
+    std::vector<std::unique_ptr<BkmaContext>> scratch_;
+    std::vector<size_t> offsets0_;   // first line of each slice, n0 last
+    std::vector<BkmaOptimParams> optim_params_;
+
+  public:
+    BkmaMultiDevice() = delete;
+    BkmaMultiDevice(const BkmaMultiDevice &) = delete;
+    BkmaMultiDevice &operator=(const BkmaMultiDevice &) = delete;
+
+    explicit BkmaMultiDevice(const std::vector<sycl::device> &devices)
+        : devices_(devices), context_(devices) {
+        if (devices_.empty())
+            throw std::invalid_argument("BkmaMultiDevice needs a device");
+
+        for (const auto &d : devices_) {
+            queues_.emplace_back(context_, d);
+            scratch_.push_back(std::make_unique<BkmaContext>(queues_.back()));
+        }
+    }
+
+    [[nodiscard]] inline size_t size() const { return devices_.size(); }
+    [[nodiscard]] inline sycl::queue &queue(const size_t i) {
+        return queues_[i];
+    }
+    [[nodiscard]] inline const BkmaOptimParams &
+    optim_params(const size_t i) const {
+        return optim_params_[i];
+    }
+
+    // ==========================================
+    /* Splits n0 evenly and plans each slice on its device. Params must have
+    the n0, n1, n2 members used by create_optim_params. */
+    template <typename Params> void plan(const Params &params) {
+        const auto n_slices = std::min(size(), params.n0);
+        offsets0_.assign(1, 0);
+        optim_params_.clear();
+        for (size_t i = 0; i < n_slices; ++i) {
+            auto slice_params = params_of_slice(params, i, n_slices);
+            offsets0_.push_back(offsets0_.back() + slice_params.n0);
+            optim_params_.push_back(
+                create_optim_params<Params>(queues_[i], slice_params));
+        }
+    }
+
+    // ==========================================
+    /* Params of slice i out of n_slices */
+    template <typename Params>
+    [[nodiscard]] static Params
+    params_of_slice(const Params &params, const size_t i,
+                    const size_t n_slices) {
+        Params slice_params = params;
+        slice_params.n0 =
+            params.n0 / n_slices + (i < params.n0 % n_slices ? 1 : 0);
+        return slice_params;
+    }
+
+    // ==========================================
+    [[nodiscard]] inline size_t n_slices() const {
+        return optim_params_.size();
+    }
+
+    // ==========================================
+    /* Lines [offsets0_[i], offsets0_[i+1]) of data */
+    [[nodiscard]] span3d_t slice(span3d_t data, const size_t i) const {
+        const auto n1 = data.extent(1);
+        const auto n2 = data.extent(2);
+        return span3d_t(data.data_handle() + offsets0_[i] * n1 * n2,
+                        offsets0_[i + 1] - offsets0_[i], n1, n2);
+    }
+
+    // ==========================================
+    /* Shared USM usable by every device of the context. Pages are placed
+    on first touch, initialize each slice from its own queue. */
+    [[nodiscard]] span3d_t alloc(const size_t n0, const size_t n1,
+                                 const size_t n2) {
+        auto ptr =
+            sycl::malloc_shared<real_t>(n0 * n1 * n2, devices_[0], context_);
+        if (ptr == nullptr)
+            throw std::runtime_error("Failed to allocate shared memory");
+        return span3d_t(ptr, n0, n1, n2);
+    }
+
+    // ==========================================
+    void free(span3d_t data) { sycl::free(data.data_handle(), context_); }
+
+    // ==========================================
+    /* One bkma_run per slice, the returned event completes when all of
+    them do */
+    template <class MySolver, BkmaImpl Impl>
+    sycl::event run(span3d_t data, const MySolver &solver) {
+        const auto nw = data.extent(1) - (solver.window() - 1);
+
+        std::vector<sycl::event> events;
+        for (size_t i = 0; i < n_slices(); ++i) {
+            OffsetSolver<MySolver> slice_solver{solver, offsets0_[i]};
+            auto p = optim_params_[i];
+            p.work_counters = scratch_[i]->work_counters();
+            events.push_back(bkma_run<OffsetSolver<MySolver>, Impl>(
+                queues_[i], slice(data, i), slice_solver, p,
+                scratch_[i]->scratch(p, nw)));
+        }
+
+        /* Queues share the context, the join can depend on all of them */
+        return join_events(queues_[0], events);
+    }
+
+    // ==========================================
+    void wait() {
+        for (auto &q : queues_)
+            q.wait();
+    }
+};   // end class BkmaMultiDevice
@@ -0,0 +1,122 @@
+#pragma once
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <utility>
+#include <vector>
+#include <sycl/sycl.hpp>
+#include <bkma.hpp>
+#include <autotuner.hpp>
+#include <init.hpp>
+
+// ==========================================
+// ==========================================
+/* Tunes BkmaOptimParams on the real time loop: each candidate is used for
+n_trials iterations, then the fastest one is locked in for the rest of the
+run. The minimum time of the trials is kept so that the first iteration,
+which includes the JIT compilation, does not penalize its candidate. */
+class OnlineTuner {
+    std::vector<BkmaOptimParams> candidates_;
+    std::vector<double> best_times_;
+    size_t n_trials_;
+    size_t iter_ = 0;
+    size_t best_ = 0;
+
+  public:
+    OnlineTuner() = delete;
+
+    OnlineTuner(std::vector<BkmaOptimParams> candidates, const size_t n_trials)
+        : candidates_(std::move(candidates)),
+          best_times_(candidates_.size(), std::numeric_limits<double>::max()),
+          n_trials_(std::max<size_t>(n_trials, 1)) {
+        if (candidates_.empty())
+            throw std::invalid_argument("OnlineTuner needs candidates");
+    }
+
+    // ==========================================
+    [[nodiscard]] inline bool exploring() const {
+        return iter_ < candidates_.size() * n_trials_;
+    }
+
+    // ==========================================
+    /* Parameters to use for the next iteration */
+    [[nodiscard]] inline const BkmaOptimParams &current() const {
+        return exploring() ? candidates_[iter_ / n_trials_]
+                           : candidates_[best_];
+    }
+
+    // ==========================================
+    /* Records the time of the iteration that ran with current() */
+    void record(const double seconds) {
+        if (!exploring())
+            return;
+
+        auto &t = best_times_[iter_ / n_trials_];
+        t = std::min(t, seconds);
+        ++iter_;
+
+        if (!exploring()) {
+            best_ = std::min_element(best_times_.begin(), best_times_.end()) -
+                    best_times_.begin();
+            const auto &p = candidates_[best_];
+            std::cout << "Online tuning locked candidate " << best_ << "/"
+                      << candidates_.size() << ": w = (" << p.w0 << ", "
+                      << p.w1 << ", " << p.w2 << "), s = ("
+                      << p.wg_dispatch.s0_ << ", " << p.wg_dispatch.s2_
+                      << "), " << mem_space_to_string(p.mem_space) << " ("
+                      << best_times_[best_] << " s/iter)" << std::endl;
+        }
+    }
+};   // end class OnlineTuner
+
+// ==========================================
+// ==========================================
+/* A few configurations around the heuristic: the heuristic itself, the cost
+model prediction and the power of two work-group sizes, in the memory space
+impl prefers. Duplicates and the configurations impl cannot run, see
+impl_unsupported, are removed. */
+template <typename Params>
+std::vector<BkmaOptimParams>
+online_candidates(sycl::queue &q, const Params &params, const BkmaImpl impl,
+                  const size_t window, const bool line_passes = false) {
+    const auto &dev = DeviceProfile::get(q.get_device());
+    const auto [local_scratch, global_scratch] = visit_impl(impl, [](auto I) {
+        using Traits = ImplTraits<decltype(I)::value>;
+        return std::pair{Traits::local_scratch, Traits::global_scratch};
+    });
+
+    std::vector<BkmaOptimParams> candidates;
+    auto add = [&](const BkmaOptimParams &p) {
+        auto same = [&](const BkmaOptimParams &o) {
+            return o.w0 == p.w0 && o.w1 == p.w1 && o.w2 == p.w2 &&
+                   o.wg_dispatch.s0_ == p.wg_dispatch.s0_ &&
+                   o.wg_dispatch.s2_ == p.wg_dispatch.s2_ &&
+                   o.mem_space == p.mem_space;
+        };
+        if (impl_unsupported(impl, dev, p, params.n1, window, line_passes)
+                .empty() &&
+            std::none_of(candidates.begin(), candidates.end(), same))
+            candidates.push_back(p);
+    };
+
+    add(create_optim_params<Params>(q, params, line_passes));
+    try {
+        add(model_optim_params<Params>(q, params, window, global_scratch));
+    } catch (const std::invalid_argument &) {
+        /* The model found nothing fitting, keep the heuristic */
+    }
+
+    const auto mem_space =
+        local_scratch ? MemorySpace::Local : MemorySpace::Global;
+    for (size_t wg = 64; wg <= dev.max_wg_size; wg *= 2) {
+        try {
+            add(make_optim_params(
+                q, params,
+                {wg, params.seq_size0, params.seq_size2, mem_space}));
+        } catch (const std::invalid_argument &) {
+            /* Sizes incompatible with the problem shape */
+        }
+    }
+
+    return candidates;
+}   // end online_candidates
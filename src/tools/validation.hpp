@@ -6,7 +6,7 @@
 
 // ==========================================
 // ==========================================
-real_t
+inline real_t
 validate_result_adv(sycl::queue &Q, span3d_t &data, const ADVParams &params,
                     bool do_print = true) {
     if(do_print)
@@ -81,7 +81,7 @@ validate_result_adv(sycl::queue &Q, span3d_t &data, const ADVParams &params,
 
 // ==========================================
 // ==========================================
-real_t
+inline real_t
 sum_and_normalize_conv1d(sycl::queue &Q, span3d_t data, size_t nw) {
     auto n0 = data.extent(0);
     auto n2 = data.extent(2);
@@ -111,7 +111,7 @@ sum_and_normalize_conv1d(sycl::queue &Q, span3d_t data, size_t nw) {
 
 // ==========================================
 // ==========================================
-void
+inline void
 validate_conv1d(sycl::queue &Q, span3d_t &data, size_t nw) {
     const auto n0 = data.extent(0);
     const auto n2 = data.extent(2);
@@ -157,7 +157,7 @@ validate_conv1d(sycl::queue &Q, span3d_t &data, size_t nw) {
 
 // ==========================================
 // ==========================================
-void print_perf(const double elapsed_seconds, const size_t n_cells){
+inline void print_perf(const double elapsed_seconds, const size_t n_cells){
 
     std::cout << "PERF_DIAGS:" << std::endl;
     std::cout << "elapsed_time: " << elapsed_seconds << " s\n";
@@ -0,0 +1,114 @@
+#include "gtest/gtest.h"
+#include <AdvectionParams.hpp>
+#include <AdvectionSolver.hpp>
+#include <BatchedAdvectionSolver.hpp>
+#include <sycl/sycl.hpp>
+#include <vector>
+#include <batched_problems.hpp>
+#include <bkma.hpp>
+#include "test_helpers.hpp"
+
+static constexpr double EPS = 1e-5;
+static constexpr size_t N_STEPS = 5;
+
+// =============================================================================
+/* Problems of a parameter scan: different velocities, dt and n0 */
+static std::vector<ADVParams>
+scan_params(const size_t n2) {
+    std::vector<ADVParams> problems;
+    for (size_t p = 0; p < 3; ++p) {
+        ADVParams params;
+        params.n0 = 8 + 4 * p;
+        params.n1 = 256;
+        params.n2 = n2;
+        params.dt = 0.001 * (p + 1);
+        params.minRealVx = -1. - p;
+        params.maxRealVx = 1. + p;
+        params.maxIter = N_STEPS;
+        params.pref_wg_size = 64;
+        params.seq_size0 = 1;
+        params.seq_size2 = 1;
+        params.update_deltas();
+        problems.push_back(params);
+    }
+    return problems;
+}
+
+// =============================================================================
+TEST(Batched, StackedAlongN0MatchesSeparateRuns) {
+    sycl::queue Q;
+    const auto problems = scan_params(2);
+    AdvectionBatch batch(Q, problems, BatchAxis::D0);
+    const auto params = batch.params();
+    const auto n1 = params.n1, n2 = params.n2;
+
+    span3d_t data(sycl_alloc(params.n0 * n1 * n2, Q), params.n0, n1, n2);
+    batch.fill(data);
+    advance(Q, data, params, batch.solver());
+
+    std::vector<real_t> host(params.n0 * n1 * n2);
+    Q.copy(data.data_handle(), host.data(), host.size()).wait();
+
+    size_t offset = 0;
+    for (const auto &p : problems) {
+        const auto expected = run_steps(Q, p, AdvectionSolver(p));
+        for (size_t i = 0; i < expected.size(); ++i)
+            EXPECT_NEAR(host[offset + i], expected[i], EPS);
+        offset += expected.size();
+    }
+    sycl::free(data.data_handle(), Q);
+}
+
+// =============================================================================
+TEST(Batched, StackedAlongN2MatchesSeparateRuns) {
+    sycl::queue Q;
+    auto problems = scan_params(1);
+    for (auto &p : problems) {
+        p.n0 = 16;
+        p.update_deltas();
+    }
+    AdvectionBatch batch(Q, problems, BatchAxis::D2);
+    const auto params = batch.params();
+    const auto n0 = params.n0, n1 = params.n1, n2 = params.n2;
+    ASSERT_EQ(n2, problems.size());
+
+    span3d_t data(sycl_alloc(n0 * n1 * n2, Q), n0, n1, n2);
+    batch.fill(data);
+    advance(Q, data, params, batch.solver());
+
+    std::vector<real_t> host(n0 * n1 * n2);
+    Q.copy(data.data_handle(), host.data(), host.size()).wait();
+
+    for (size_t p = 0; p < problems.size(); ++p) {
+        const auto expected =
+            run_steps(Q, problems[p], AdvectionSolver(problems[p]));
+        for (size_t i0 = 0; i0 < n0; ++i0)
+            for (size_t i1 = 0; i1 < n1; ++i1)
+                EXPECT_NEAR(host[(i0 * n1 + i1) * n2 + p],
+                            expected[i0 * n1 + i1], EPS);
+    }
+    sycl::free(data.data_handle(), Q);
+}
+
+// =============================================================================
+TEST(Batched, ErrorsStaySmall) {
+    sycl::queue Q;
+    AdvectionBatch batch(Q, scan_params(1), BatchAxis::D0);
+    const auto params = batch.params();
+    span3d_t data(sycl_alloc(params.n0 * params.n1 * params.n2, Q), params.n0,
+                  params.n1, params.n2);
+    batch.fill(data);
+    advance(Q, data, params, batch.solver());
+
+    for (auto err : batch.errors(data, N_STEPS))
+        EXPECT_LT(err, 1e-3);
+    sycl::free(data.data_handle(), Q);
+}
+
+// =============================================================================
+TEST(Batched, RejectsDifferentN1) {
+    sycl::queue Q;
+    auto problems = scan_params(1);
+    problems.back().n1 = 128;
+    EXPECT_THROW(AdvectionBatch(Q, problems), std::invalid_argument);
+}
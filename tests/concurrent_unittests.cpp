@@ -0,0 +1,88 @@
+#include "gtest/gtest.h"
+#include <AdvectionParams.hpp>
+#include <AdvectionSolver.hpp>
+#include <sycl/sycl.hpp>
+#include <thread>
+#include <vector>
+#include <bkma.hpp>
+#include "test_helpers.hpp"
+
+// =============================================================================
+/* Small problem, n0 varies so that each thread gets its own plan */
+static ADVParams
+small_params(const size_t n0) {
+    ADVParams params;
+    params.n0 = n0;
+    params.n1 = 512;
+    params.n2 = 3;
+    params.maxIter = 10;
+    params.pref_wg_size = 128;
+    params.seq_size0 = 1;
+    params.seq_size2 = 1;
+    params.update_deltas();
+    return params;
+}
+
+// =============================================================================
+/* Runs a whole advection on a queue and a BkmaContext of its own, returns
+the final distribution on the host */
+template <BkmaImpl Impl>
+static std::vector<real_t>
+run_advection(const sycl::device &d, const ADVParams &params) {
+    sycl::queue Q(d);
+    return run_steps<AdvectionSolver, Impl>(Q, params,
+                                            AdvectionSolver(params));
+}
+
+// =============================================================================
+/* Even runs use AdaptiveWg, odd runs the Persistent kernel and its counters */
+static std::vector<real_t>
+run_advection(const size_t i, const sycl::device &d, const ADVParams &params) {
+    return i % 2 == 0 ? run_advection<BkmaImpl::AdaptiveWg>(d, params)
+                      : run_advection<BkmaImpl::Persistent>(d, params);
+}
+
+// =============================================================================
+TEST(Concurrent, ThreadsMatchSequentialRuns) {
+    const sycl::device d;
+    constexpr size_t n_threads = 8;
+
+    std::vector<ADVParams> params;
+    for (size_t i = 0; i < n_threads; ++i)
+        params.push_back(small_params(16 + 8 * i));
+
+    std::vector<std::vector<real_t>> expected;
+    for (size_t i = 0; i < n_threads; ++i)
+        expected.push_back(run_advection(i, d, params[i]));
+
+    std::vector<std::vector<real_t>> results(n_threads);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < n_threads; ++i)
+        threads.emplace_back(
+            [&, i]() { results[i] = run_advection(i, d, params[i]); });
+    for (auto &t : threads)
+        t.join();
+
+    for (size_t i = 0; i < n_threads; ++i) {
+        ASSERT_EQ(results[i].size(), expected[i].size());
+        for (size_t j = 0; j < results[i].size(); ++j)
+            EXPECT_EQ(results[i][j], expected[i][j]) << "thread " << i;
+    }
+}
+
+// =============================================================================
+TEST(Concurrent, ThreadsShareOneDeviceProfile) {
+    const sycl::device d;
+    constexpr size_t n_threads = 8;
+
+    std::vector<const DeviceProfile *> profiles(n_threads);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < n_threads; ++i)
+        threads.emplace_back(
+            [&, i]() { profiles[i] = &DeviceProfile::get(d); });
+    for (auto &t : threads)
+        t.join();
+
+    for (const auto p : profiles)
+        EXPECT_EQ(p, profiles.front());
+}
@@ -0,0 +1,98 @@
+#include "gtest/gtest.h"
+#include <AdvectionParams.hpp>
+#include <AdvectionSolver.hpp>
+#include <stdexcept>
+#include <sycl/sycl.hpp>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include <bkma.hpp>
+#include <impl_selector.hpp>
+#include "test_helpers.hpp"
+
+static constexpr double EPS = 1e-14;
+static constexpr size_t N_STEPS = 3;
+
+// =============================================================================
+/* Work-groups of w0 = 2 lines (n1 * n2 < pref_wg_size) and odd n0, in one
+batch or in several with a small scratch */
+static std::vector<ADVParams>
+dispatch_params() {
+    std::vector<ADVParams> shapes;
+    for (auto [n0, max_scratch_mb] : {std::tuple{13, 0}, std::tuple{8195, 1}}) {
+        ADVParams params;
+        params.n0 = n0;
+        params.n1 = 64;
+        params.n2 = 2;
+        params.maxIter = N_STEPS;
+        params.pref_wg_size = 256;
+        params.seq_size0 = 1;
+        params.seq_size2 = 1;
+        params.max_scratch_mb = max_scratch_mb;
+        params.update_deltas();
+        shapes.push_back(params);
+    }
+    return shapes;
+}
+
+// =============================================================================
+/* 60% of 13 lines is 7, rounded down to 6 local lines for w0 = 2: the
+global kernel gets the 7 others, starting on an odd line */
+TEST(Dispatch, HybridMatchesLocalAndGlobal) {
+    sycl::queue Q;
+    for (auto params : dispatch_params()) {
+        params.percent_loc = 0.6f;
+        const AdvectionSolver solver(params);
+        const auto optim_params = create_optim_params<ADVParams>(Q, params);
+        ASSERT_EQ(optim_params.mem_space, MemorySpace::Hybrid);
+        ASSERT_EQ(optim_params.w0, size_t{2});
+
+        const auto hybrid = run_steps(Q, params, solver);
+        const auto local = run_steps(Q, params, solver, MemorySpace::Local);
+        const auto global = run_steps(Q, params, solver, MemorySpace::Global);
+        for (size_t i = 0; i < hybrid.size(); ++i) {
+            EXPECT_NEAR(hybrid[i], local[i], EPS);
+            EXPECT_NEAR(hybrid[i], global[i], EPS);
+        }
+    }
+}
+
+// =============================================================================
+/* Batches and steps enqueued ahead of the host, through the global scratch
+shared by the batches: the results are those of the synchronous run */
+TEST(Dispatch, InFlightMatchesSynchronousRun) {
+    sycl::queue Q;
+    auto params = dispatch_params().back();
+    params.percent_loc = 0;
+    const AdvectionSolver solver(params);
+    const auto optim_params = create_optim_params<ADVParams>(Q, params);
+    ASSERT_EQ(optim_params.mem_space, MemorySpace::Global);
+    ASSERT_GT(optim_params.dispatch_d0.n_batch_ *
+                  optim_params.dispatch_d2.n_batch_,
+              size_t{3});
+
+    const auto expected = run_steps(Q, params, solver);
+    for (auto [batchs, steps] : {std::pair{1, 3}, std::pair{3, 1},
+                                 std::pair{3, 3}}) {
+        params.batchs_in_flight = batchs;
+        params.steps_in_flight = steps;
+        const auto result = run_steps(Q, params, solver);
+        for (size_t i = 0; i < result.size(); ++i)
+            ASSERT_EQ(result[i], expected[i])
+                << batchs << " batches and " << steps
+                << " steps in flight, cell " << i;
+    }
+}
+
+// =============================================================================
+/* No implementation is picked when none of them runs */
+TEST(Dispatch, FastestImplThrowsWhenEveryImplFails) {
+    sycl::queue Q;
+    const auto params = dispatch_params().front();
+    const auto optim_params = create_optim_params<ADVParams>(Q, params);
+    auto fail = [](BkmaImpl impl) -> sycl::event {
+        throw std::invalid_argument("rejected " + impl_to_string(impl));
+    };
+    EXPECT_THROW(fastest_impl(Q, optim_params, params.n1, 1, false, fail),
+                 std::runtime_error);
+}
@@ -0,0 +1,81 @@
+#include "gtest/gtest.h"
+#include <AdvectionParams.hpp>
+#include <AdvectionSolver.hpp>
+#include <sycl/sycl.hpp>
+#include <vector>
+#include <bkma.hpp>
+#include <multi_device.hpp>
+#include "test_helpers.hpp"
+
+static constexpr double EPS = 1e-14;
+static constexpr size_t N_STEPS = 5;
+
+// =============================================================================
+/* The lines of one queue split in uneven slices as BkmaMultiDevice splits
+them across devices: each slice is solved with the offset of its first line
+and must reproduce the run on the whole buffer */
+TEST(MultiDevice, SlicesMatchSingleRun) {
+    sycl::queue Q;
+    const auto params = shifting_params(23, 128, 3, N_STEPS);
+    const AdvectionSolver solver(params);
+    const auto expected = run_steps(Q, params, solver);
+
+    const auto n0 = params.n0, n1 = params.n1, n2 = params.n2;
+    for (size_t n_slices : {2, 3, 5}) {
+        span3d_t data(sycl_alloc(n0 * n1 * n2, Q), n0, n1, n2);
+        fill_buffer_adv(Q, data, params);
+
+        size_t offset0 = 0;
+        for (size_t i = 0; i < n_slices; ++i) {
+            const auto slice_params =
+                BkmaMultiDevice::params_of_slice(params, i, n_slices);
+            span3d_t slice(data.data_handle() + offset0 * n1 * n2,
+                           slice_params.n0, n1, n2);
+            advance(Q, slice, slice_params,
+                    OffsetSolver<AdvectionSolver>{solver, offset0});
+            offset0 += slice_params.n0;
+        }
+        ASSERT_EQ(offset0, n0);
+
+        std::vector<real_t> result(n0 * n1 * n2);
+        Q.copy(data.data_handle(), result.data(), result.size()).wait();
+        sycl::free(data.data_handle(), Q);
+        for (size_t i = 0; i < result.size(); ++i)
+            EXPECT_NEAR(result[i], expected[i], EPS)
+                << n_slices << " slices, cell " << i;
+    }
+}
+
+// =============================================================================
+/* plan, slice, alloc and run of BkmaMultiDevice on the device of Q, and on
+its NUMA domains if it has several */
+TEST(MultiDevice, RunMatchesSingleQueue) {
+    sycl::queue Q;
+    const auto params = shifting_params(23, 128, 3, N_STEPS);
+    const AdvectionSolver solver(params);
+    const auto expected = run_steps(Q, params, solver);
+
+    const auto d = Q.get_device();
+    for (const auto &devices : {std::vector<sycl::device>{d},
+                                select_devices(d, "numa")}) {
+        BkmaMultiDevice md(devices);
+        md.plan(params);
+        ASSERT_EQ(md.n_slices(), devices.size());
+
+        auto data = md.alloc(params.n0, params.n1, params.n2);
+        for (size_t i = 0; i < md.n_slices(); ++i) {
+            auto slice = md.slice(data, i);
+            fill_buffer_adv(md.queue(i), slice,
+                            BkmaMultiDevice::params_of_slice(
+                                params, i, md.n_slices()));
+        }
+        for (size_t t = 0; t < N_STEPS; ++t)
+            md.run<AdvectionSolver, BkmaImpl::AdaptiveWg>(data, solver).wait();
+
+        const auto cells = data.data_handle();
+        for (size_t i = 0; i < expected.size(); ++i)
+            EXPECT_NEAR(cells[i], expected[i], EPS)
+                << devices.size() << " devices, cell " << i;
+        md.free(data);
+    }
+}
@@ -0,0 +1,166 @@
+#include "gtest/gtest.h"
+#include <AdvectionParams.hpp>
+#include <AdvectionSolver.hpp>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <bkma_batch_planner.hpp>
+#include <bkma_tools.hpp>
+#include <DeviceProfile.hpp>
+
+/* Shapes of the n0 = 2**27 benchmarks and beyond, planned without
+allocating anything */
+static constexpr size_t N0_BENCH = size_t{1} << 27;
+static constexpr size_t N_HUGE = (size_t{1} << 40) + 7;
+
+// =============================================================================
+/* Batches must cover exactly n, none empty nor above the batch size */
+static void
+expect_exact_cover(const BatchConfig1D &bconf, const size_t n) {
+    ASSERT_GT(bconf.n_batch_, size_t{0});
+    EXPECT_LE(bconf.batch_size_, n);
+    EXPECT_GT(bconf.last_batch_size_, size_t{0});
+    EXPECT_LE(bconf.last_batch_size_, bconf.batch_size_);
+    EXPECT_EQ(bconf.offset(bconf.n_batch_ - 1) + bconf.last_batch_size_, n);
+}
+
+/* Limits of a CUDA device, see DeviceProfile */
+static DeviceProfile
+cuda_like_profile() {
+    DeviceProfile dev{};
+    dev.max_wg_size = 1024;
+    dev.max_wi_sizes = {64, 1024, 1024};
+    dev.compute_units = 108;
+    dev.local_mem_size = 48 * 1024;
+    dev.max_alloc_elems = (size_t{1} << 33) / sizeof(real_t);
+    dev.max_work_groups = {(1 << 16) - 1, (1 << 16) - 1,
+                           (size_t{1} << 31) - 1};
+    dev.max_global_range = std::numeric_limits<size_t>::max();
+    return dev;
+}
+
+// =============================================================================
+TEST(Planner, BlockingIsExactAboveFloatPrecision) {
+    /* 2**24 + 1 is the first integer a float cannot hold */
+    const size_t n = (size_t{1} << 24) + 1;
+    const auto bconf = init_1d_blocking(n, 1);
+    EXPECT_EQ(bconf.n_batch_, n);
+    expect_exact_cover(bconf, n);
+
+    for (auto b : {size_t{3}, size_t{65535}, size_t{1} << 24}) {
+        expect_exact_cover(init_1d_blocking(n, b), n);
+        expect_exact_cover(init_1d_blocking(N0_BENCH - 1, b), N0_BENCH - 1);
+        expect_exact_cover(init_1d_blocking(N_HUGE, b), N_HUGE);
+    }
+}
+
+// =============================================================================
+TEST(Planner, BlockingEdgeCases) {
+    const auto single = init_1d_blocking(N0_BENCH, N0_BENCH + 1);
+    EXPECT_EQ(single.n_batch_, size_t{1});
+    EXPECT_EQ(single.last_batch_size_, N0_BENCH);
+
+    const auto even = init_1d_blocking(N0_BENCH, 1 << 10);
+    EXPECT_EQ(even.n_batch_, size_t{1} << 17);
+    EXPECT_EQ(even.last_batch_size_, size_t{1} << 10);
+
+    EXPECT_EQ(init_1d_blocking(0, 128).n_batch_, size_t{0});
+}
+
+// =============================================================================
+TEST(Planner, DispatchIsExact) {
+    const auto kd = dispatch_kernels(N0_BENCH + 1, 0.5f);
+    EXPECT_EQ(kd.k_local_, N0_BENCH / 2);
+    EXPECT_EQ(kd.k_local_ + kd.k_global_, N0_BENCH + 1);
+}
+
+// =============================================================================
+/* Every batch fits in the launch limits and the batches cover the lines */
+TEST(Planner, BenchShapesFitLaunchLimits) {
+    const auto dev = cuda_like_profile();
+    WorkGroupDispatch wg;
+    wg.s0_ = 1;
+    wg.s2_ = 1;
+
+    for (auto [n0, n2] : {std::pair{N0_BENCH, size_t{1}},
+                          std::pair{N0_BENCH + 3, size_t{2}},
+                          std::pair{size_t{1} << 20, size_t{1} << 12}}) {
+        for (auto mem_space : {MemorySpace::Local, MemorySpace::Global}) {
+            const size_t w0 = 1, w2 = n2 == 1 ? 1 : 2;
+            const auto [b0, b2] =
+                plan_batchs(dev, n0, n2, w0, w2, wg, mem_space, 1024);
+            expect_exact_cover(b0, n0);
+            expect_exact_cover(b2, n2);
+
+            const auto g0 = (b0.batch_size_ + w0 - 1) / w0;
+            const auto g2 = (b2.batch_size_ + w2 - 1) / w2;
+            EXPECT_LE(g0, dev.max_work_groups[0]);
+            EXPECT_LE(g2, dev.max_work_groups[2]);
+            if (mem_space == MemorySpace::Global)
+                EXPECT_LE(b0.batch_size_ * b2.batch_size_ * 1024,
+                          dev.max_alloc_elems);
+        }
+    }
+}
+
+// =============================================================================
+/* A scratch too small for one work-group row is an error, not an overflow
+of the cap */
+TEST(Planner, ScratchBelowOneRowThrows) {
+    auto dev = cuda_like_profile();
+    WorkGroupDispatch wg;
+    wg.s0_ = 2;
+    wg.s2_ = 2;
+    const size_t n0 = 1 << 10, n2 = 1 << 10, w0 = 4, w2 = 8, line = 1024;
+
+    /* Exactly one row of (4 * 2) x (8 * 2) lines */
+    dev.max_alloc_elems = 128 * line;
+    const auto [b0, b2] =
+        plan_batchs(dev, n0, n2, w0, w2, wg, MemorySpace::Global, line);
+    EXPECT_LE(b0.batch_size_ * b2.batch_size_, size_t{128});
+    expect_exact_cover(b0, n0);
+    expect_exact_cover(b2, n2);
+
+    dev.max_alloc_elems = 127 * line;
+    for (auto mem_space : {MemorySpace::Global, MemorySpace::Hybrid})
+        EXPECT_THROW(
+            plan_batchs(dev, n0, n2, w0, w2, wg, mem_space, line),
+            std::invalid_argument);
+    EXPECT_EQ(plan_batchs(dev, n0, n2, w0, w2, wg, MemorySpace::Local, line)
+                  .first.batch_size_,
+              n0);
+}
+
+// =============================================================================
+/* Line accessor over a virtual extent, records the cells read */
+struct VirtualLine {
+    std::vector<size_t> *reads;
+    real_t operator()(const size_t i) const {
+        reads->push_back(i);
+        return static_cast<real_t>(i % 1024);
+    }
+};
+
+/* The stencil of cells past 2**32 must wrap at n1 and land on the right
+cells, with dt = 0 the foot is the cell itself */
+TEST(Planner, SolverIndexesBeyond32Bits) {
+    ADVParams params;
+    params.n0 = 1;
+    params.n1 = size_t{1} << 33;   // dx exact, the foot is i1 exactly
+    params.dt = 0;
+    params.update_deltas();
+
+    for (auto i1 : {size_t{0}, (size_t{1} << 32) + 5, params.n1 - 1}) {
+        std::vector<size_t> reads;
+        const auto value =
+            AdvectionSolver::solve(params, VirtualLine{&reads}, 0, i1);
+
+        ASSERT_EQ(reads.size(), size_t{LAG_PTS});
+        for (int k = 0; k < LAG_PTS; ++k)
+            EXPECT_EQ(reads[k],
+                      (params.n1 + i1 + k - LAG_OFFSET) % params.n1);
+        EXPECT_NEAR(value, static_cast<real_t>(i1 % 1024), 1e-6);
+    }
+}
@@ -0,0 +1,108 @@
+#include "gtest/gtest.h"
+#include <ConvSolver.hpp>
+#include <algorithm>
+#include <numeric>
+#include <sycl/sycl.hpp>
+#include <vector>
+#include <bkma.hpp>
+
+// =============================================================================
+TEST(Ragged, BalanceLinesCoversEveryLineOnce) {
+    std::vector<size_t> lengths;
+    for (size_t r = 0; r < 100; ++r)
+        lengths.push_back(10 + (r * 37) % 200);
+
+    const size_t n_tiles = 7;
+    const auto tiles = balance_lines(lengths, n_tiles);
+    ASSERT_EQ(tiles.offsets.size(), n_tiles + 1);
+
+    auto lines = tiles.lines;
+    std::sort(lines.begin(), lines.end());
+    for (size_t r = 0; r < lengths.size(); ++r)
+        EXPECT_EQ(lines[r], r);
+
+    /* Greedy longest first: loads differ by at most the longest line */
+    std::vector<size_t> loads;
+    for (size_t t = 0; t < n_tiles; ++t) {
+        size_t cells = 0;
+        for (auto i = tiles.offsets[t]; i < tiles.offsets[t + 1]; ++i)
+            cells += lengths[tiles.lines[i]];
+        loads.push_back(cells);
+    }
+    const auto [lo, hi] = std::minmax_element(loads.begin(), loads.end());
+    EXPECT_LE(*hi - *lo, *std::max_element(lengths.begin(), lengths.end()));
+}
+
+// =============================================================================
+TEST(Ragged, ConvMatchesHostReference) {
+    sycl::queue Q;
+    const size_t k = 3, channels = 2;
+
+    std::vector<size_t> lengths;
+    for (size_t r = 0; r < 50; ++r)
+        lengths.push_back((k + (r * 13) % 60) * channels);
+    RaggedBatch batch(Q, lengths, 32);
+
+    span3d_t weight(sycl_alloc(k * channels * channels, Q), k, channels,
+                    channels);
+    span1d_t bias(sycl_alloc(channels, Q), channels);
+    Q.fill(weight.data_handle(), real_t(1.5), k * channels * channels);
+    Q.fill(bias.data_handle(), real_t(1.0), channels);
+
+    std::vector<real_t> host(batch.size());
+    for (size_t r = 0; r < batch.n_lines(); ++r)
+        for (size_t i = 0; i < batch.length(r); ++i)
+            host[batch.offset(r) + i] = real_t((i % 5) + r);
+
+    auto data = sycl_alloc(batch.size(), Q);
+    Q.copy(host.data(), data, host.size()).wait();
+
+    ConvSolver solver{weight, bias, k, channels, 0};
+    submit_ragged(Q, batch, data, solver).wait();
+
+    std::vector<real_t> result(batch.size());
+    Q.copy(data, result.data(), result.size()).wait();
+
+    for (size_t r = 0; r < batch.n_lines(); ++r) {
+        const auto n1 = batch.length(r);
+        const auto length = n1 / channels;
+        const auto line = host.data() + batch.offset(r);
+        for (size_t iw = 0; iw < n1 - (k - 1); ++iw) {
+            const auto i1 = iw + k - 1;
+            const auto i_l = i1 - (i1 / length) * length;
+            real_t expected = 1.0;
+            for (size_t ic = 0; ic < channels; ++ic)
+                for (size_t kk = 0; kk <= std::min(i_l, k - 1); ++kk)
+                    expected += line[i_l - kk] * 1.5;
+            EXPECT_NEAR(result[batch.offset(r) + iw], expected, 1e-4)
+                << "line " << r << " cell " << iw;
+        }
+    }
+
+    sycl::free(data, Q);
+    sycl::free(weight.data_handle(), Q);
+    sycl::free(bias.data_handle(), Q);
+}
+
+// =============================================================================
+TEST(Ragged, RejectsLinesShorterThanTheWindow) {
+    sycl::queue Q;
+    RaggedBatch batch(Q, {8, 2, 8}, 4);
+    auto data = sycl_alloc(batch.size(), Q);
+    ConvSolver solver{span3d_t{}, span1d_t{}, 3, 1, 0};
+    EXPECT_THROW(submit_ragged(Q, batch, data, solver), std::invalid_argument);
+    sycl::free(data, Q);
+}
+
+// =============================================================================
+/* A line of 7 cells is not a whole number of 2 channels */
+TEST(Ragged, RejectsLinesOfPartialChannels) {
+    sycl::queue Q;
+    RaggedBatch batch(Q, {8, 7, 8}, 4);
+    auto data = sycl_alloc(batch.size(), Q);
+    ConvSolver solver{span3d_t{}, span1d_t{}, 3, 2, 0};
+    EXPECT_TRUE(solver.valid_length(8));
+    EXPECT_FALSE(solver.valid_length(7));
+    EXPECT_THROW(submit_ragged(Q, batch, data, solver), std::invalid_argument);
+    sycl::free(data, Q);
+}
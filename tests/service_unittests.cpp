@@ -0,0 +1,207 @@
+#include "gtest/gtest.h"
+#include <chrono>
+#include <cstring>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <job_service.hpp>
+
+// =============================================================================
+TEST(Service, ParsesJobs) {
+    auto adv = parse_job("advection n0=64 n1=512 n2=2 maxIter=10 dt=0.01");
+    EXPECT_EQ(adv->kind, JobKind::Advection);
+    EXPECT_EQ(adv->adv.n0, 64);
+    EXPECT_EQ(adv->adv.n1, 512);
+    EXPECT_EQ(adv->adv.maxIter, 10);
+    EXPECT_NEAR(adv->adv.dt, 0.01, 1e-7);
+    EXPECT_EQ(adv->cells(), 64 * 512 * 2);
+
+    auto conv = parse_job("conv1d n0=4 n2=8 length=100 channels=2 k=5");
+    EXPECT_EQ(conv->kind, JobKind::Conv1d);
+    EXPECT_EQ(conv->conv.n1, 200);
+    EXPECT_EQ(conv->conv.n_write, 96);
+
+    EXPECT_THROW(parse_job("fft n0=1"), std::invalid_argument);
+    EXPECT_THROW(parse_job("advection n3=1"), std::invalid_argument);
+    EXPECT_THROW(parse_job("advection n0"), std::invalid_argument);
+    EXPECT_THROW(parse_job("conv1d length=2 k=3"), std::invalid_argument);
+}
+
+// =============================================================================
+TEST(Service, CoalescesCompatibleJobs) {
+    JobQueue jobs;
+    jobs.push(parse_job("advection n0=8 n1=256 maxIter=5"));
+    jobs.push(parse_job("conv1d n0=2 length=64"));
+    jobs.push(parse_job("advection n0=16 n1=256 maxIter=5 dt=0.01"));
+    jobs.push(parse_job("advection n0=16 n1=512 maxIter=5"));
+    jobs.push(parse_job("advection n0=4 n1=256 maxIter=5"));
+
+    const auto window = std::chrono::microseconds(0);
+    auto batch = jobs.pop_batch(window, 1000000);
+    ASSERT_EQ(batch.size(), 3);
+    EXPECT_EQ(batch[0]->adv.n0, 8);
+    EXPECT_EQ(batch[1]->adv.n0, 16);
+    EXPECT_EQ(batch[2]->adv.n0, 4);
+
+    batch = jobs.pop_batch(window, 1000000);
+    ASSERT_EQ(batch.size(), 1);
+    EXPECT_EQ(batch[0]->kind, JobKind::Conv1d);
+
+    batch = jobs.pop_batch(window, 1000000);
+    ASSERT_EQ(batch.size(), 1);
+    EXPECT_EQ(batch[0]->adv.n1, 512);
+}
+
+// =============================================================================
+TEST(Service, CapsTheCellsOfALaunch) {
+    JobQueue jobs;
+    for (int i = 0; i < 4; ++i)
+        jobs.push(parse_job("advection n0=8 n1=256 n2=1"));
+
+    auto batch = jobs.pop_batch(std::chrono::microseconds(0), 3 * 8 * 256);
+    EXPECT_EQ(batch.size(), 3);
+    jobs.close();
+    EXPECT_TRUE(jobs.pop_batch(std::chrono::microseconds(0), 1).empty());
+}
+
+// =============================================================================
+/* Value of key in a reply "ok key=value ..." */
+static double
+reply_value(const std::string &reply, const std::string &key) {
+    const auto pos = reply.find(key + "=");
+    if (pos == std::string::npos)
+        throw std::invalid_argument("no " + key + " in " + reply);
+    return std::stod(reply.substr(pos + key.size() + 1));
+}
+
+/* Replies of the jobs of lines, run in a single launch */
+static std::vector<std::string>
+run_jobs(BkmaService &service, const std::vector<std::string> &lines) {
+    std::vector<std::unique_ptr<Job>> batch;
+    std::vector<std::future<std::string>> replies;
+    for (const auto &line : lines) {
+        batch.push_back(parse_job(line));
+        replies.push_back(batch.back()->reply.get_future());
+    }
+    service.run_batch(batch);
+
+    std::vector<std::string> result;
+    for (auto &reply : replies)
+        result.push_back(reply.get());
+    return result;
+}
+
+// =============================================================================
+TEST(Service, CoalescedJobsGetTheirOwnErrors) {
+    sycl::queue Q;
+    BkmaService service(Q, std::chrono::microseconds(0), 1000000);
+    const std::vector<std::string> lines = {
+        "advection n0=8 n1=256 maxIter=5 dt=0.001",
+        "advection n0=16 n1=256 maxIter=5 dt=0.02"};
+
+    const auto coalesced = run_jobs(service, lines);
+    ASSERT_EQ(coalesced.size(), 2);
+    for (size_t i = 0; i < lines.size(); ++i) {
+        ASSERT_EQ(coalesced[i].rfind("ok ", 0), 0) << coalesced[i];
+        EXPECT_EQ(reply_value(coalesced[i], "batched"), 2);
+
+        const auto alone = run_jobs(service, {lines[i]});
+        const auto expected = reply_value(alone.front(), "l1_error");
+        EXPECT_NEAR(reply_value(coalesced[i], "l1_error"), expected,
+                    1e-5 * expected);
+    }
+    EXPECT_NE(reply_value(coalesced[0], "l1_error"),
+              reply_value(coalesced[1], "l1_error"));
+}
+
+// =============================================================================
+/* Connects to the service, retries while it is starting */
+static int
+connect_to(const std::string &path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strcpy(addr.sun_path, path.c_str());
+    for (int attempt = 0; attempt < 200; ++attempt) {
+        const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) ==
+            0)
+            return fd;
+        close(fd);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return -1;
+}
+
+static std::string
+read_reply(const int fd) {
+    std::string reply;
+    char c;
+    while (read(fd, &c, 1) == 1 && c != '\n')
+        reply += c;
+    close(fd);
+    return reply;
+}
+
+// =============================================================================
+/* A client that never sends its line is answered after the read timeout,
+and does not hold the shutdown */
+TEST(Service, IdleClientsTimeOut) {
+    sycl::queue Q;
+    BkmaService service(Q, std::chrono::microseconds(0), 1000000,
+                        std::chrono::milliseconds(100));
+    const auto path =
+        "/tmp/bkma-test-" + std::to_string(getpid()) + ".sock";
+    std::thread server([&] { service.serve(path); });
+
+    const int idle = connect_to(path);
+    ASSERT_GE(idle, 0);
+    EXPECT_EQ(read_reply(idle).rfind("error ", 0), 0);
+
+    const int idle_at_shutdown = connect_to(path);
+    const int stopper = connect_to(path);
+    ASSERT_GE(stopper, 0);
+    const std::string shutdown_line = "shutdown\n";
+    ASSERT_EQ(write(stopper, shutdown_line.data(), shutdown_line.size()),
+              ssize_t(shutdown_line.size()));
+    EXPECT_EQ(read_reply(stopper), "ok");
+
+    server.join();
+    close(idle_at_shutdown);
+}
+
+// =============================================================================
+/* Beyond max_clients connections in progress, clients are turned away */
+TEST(Service, BusyBeyondMaxClients) {
+    sycl::queue Q;
+    BkmaService service(Q, std::chrono::microseconds(0), 1000000,
+                        std::chrono::milliseconds(500), 1);
+    const auto path =
+        "/tmp/bkma-test-" + std::to_string(getpid()) + ".sock";
+    std::thread server([&] { service.serve(path); });
+
+    const int idle = connect_to(path);
+    ASSERT_GE(idle, 0);
+    const int turned_away = connect_to(path);
+    ASSERT_GE(turned_away, 0);
+    EXPECT_EQ(read_reply(turned_away), "error busy");
+
+    /* The slot is free again once the thread of the idle client, which
+    timed out, is done */
+    EXPECT_EQ(read_reply(idle).rfind("error ", 0), 0);
+    const std::string shutdown_line = "shutdown\n";
+    std::string reply;
+    for (int attempt = 0; attempt < 100 && reply != "ok"; ++attempt) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        const int stopper = connect_to(path);
+        ASSERT_GE(stopper, 0);
+        send(stopper, shutdown_line.data(), shutdown_line.size(),
+             MSG_NOSIGNAL);
+        reply = read_reply(stopper);
+    }
+    EXPECT_EQ(reply, "ok");
+    server.join();
+}
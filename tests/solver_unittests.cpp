@@ -0,0 +1,217 @@
+#include "gtest/gtest.h"
+#include <AdvectionParams.hpp>
+#include <AdvectionSolver.hpp>
+#include <CachedAdvectionSolver.hpp>
+#include <cmath>
+#include <cstdint>
+#include <sycl/sycl.hpp>
+#include <vector>
+#include <bkma.hpp>
+#include "test_helpers.hpp"
+
+static constexpr double EPS = 1e-10;
+static constexpr size_t N_STEPS = 5;
+
+// =============================================================================
+static ADVParams
+solver_params() {
+    return shifting_params(24, 256, 4, N_STEPS);
+}
+
+// =============================================================================
+TEST(CoefCache, StencilMatchesAdvectionSolver) {
+    const auto params = solver_params();
+    std::vector<real_t> line(params.n1);
+    for (size_t i = 0; i < params.n1; ++i)
+        line[i] = std::sin(0.3 * i) + i % 7;
+
+    for (size_t i0 = 0; i0 < params.n0; ++i0) {
+        const auto coefs = AdvectionCoefCache<>::make_coefs(params, i0);
+        const CachedAdvectionSolver<> cached{&coefs, params.n1};
+        for (size_t i1 = 0; i1 < params.n1; ++i1)
+            EXPECT_NEAR(cached(HostLine{&line}, 0, i1, 0),
+                        AdvectionSolver::solve(params, HostLine{&line}, i0,
+                                               i1),
+                        EPS);
+    }
+}
+
+// =============================================================================
+TEST(CoefCache, StepsMatchAdvectionSolver) {
+    sycl::queue Q;
+    const auto params = solver_params();
+    AdvectionCoefCache cache(Q, params);
+
+    const auto expected = run_steps(Q, params, AdvectionSolver(params));
+    const auto result = run_steps(Q, params, cache.solver());
+    for (size_t i = 0; i < expected.size(); ++i)
+        EXPECT_NEAR(result[i], expected[i], EPS);
+}
+
+// =============================================================================
+TEST(CoefCache, RejectsShortLines) {
+    sycl::queue Q;
+    auto params = solver_params();
+    params.n1 = LAG_PTS - 1;
+    params.update_deltas();
+    EXPECT_THROW(AdvectionCoefCache(Q, params), std::invalid_argument);
+}
+
+// =============================================================================
+/* dt*vx/dx is a whole number of cells for every velocity */
+static ADVParams
+grid_aligned_params() {
+    auto params = solver_params();
+    params.n1 = 64;
+    params.n0 = 8;
+    params.minRealVx = -4;
+    params.maxRealVx = 4;
+    params.update_deltas();
+    params.dt = params.dx;
+    return params;
+}
+
+// =============================================================================
+TEST(CoefCache, DetectsIntegerShifts) {
+    /* Only vx = 0 moves by a whole number of cells */
+    const auto params = solver_params();
+    EXPECT_EQ(AdvectionCoefCache<>::n_rotations(params), size_t{1});
+    EXPECT_TRUE(AdvectionCoefCache<>::make_coefs(params, params.n0 / 2)
+                    .rotation);
+
+    auto aligned = grid_aligned_params();
+    EXPECT_EQ(AdvectionCoefCache<>::n_rotations(aligned), aligned.n0);
+
+    /* Nearly aligned rows only take the rotation under a tolerance */
+    aligned.dt *= 1 + 1e-12;
+    EXPECT_EQ(AdvectionCoefCache<>::n_rotations(aligned), size_t{1});
+    aligned.shift_tol = 1e-9;
+    EXPECT_EQ(AdvectionCoefCache<>::n_rotations(aligned), aligned.n0);
+}
+
+// =============================================================================
+TEST(CoefCache, RotationIsExact) {
+    sycl::queue Q;
+    const auto params = grid_aligned_params();
+    const auto n0 = params.n0, n1 = params.n1, n2 = params.n2;
+
+    span3d_t data(sycl_alloc(n0 * n1 * n2, Q), n0, n1, n2);
+    fill_buffer_adv(Q, data, params);
+    std::vector<real_t> initial(n0 * n1 * n2);
+    Q.copy(data.data_handle(), initial.data(), initial.size()).wait();
+
+    AdvectionCoefCache cache(Q, params);
+    advance(Q, data, params, cache.solver());
+    std::vector<real_t> result(n0 * n1 * n2);
+    Q.copy(data.data_handle(), result.data(), result.size()).wait();
+    sycl::free(data.data_handle(), Q);
+
+    /* After N_STEPS, cell i1 holds the initial cell i1 - N_STEPS*vx/dx */
+    for (size_t i0 = 0; i0 < n0; ++i0) {
+        const auto vx = params.minRealVx + i0 * params.dvx;
+        const auto shift = static_cast<int64_t>(std::lround(vx)) * N_STEPS;
+        for (size_t i1 = 0; i1 < n1; ++i1) {
+            const auto from = ((int64_t(i1) - shift) % int64_t(n1) + n1) % n1;
+            for (size_t i2 = 0; i2 < n2; ++i2)
+                EXPECT_EQ(result[(i0 * n1 + i1) * n2 + i2],
+                          initial[(i0 * n1 + from) * n2 + i2]);
+        }
+    }
+}
+
+// =============================================================================
+/* Interpolation of order Order is exact for polynomials of degree Order */
+TEST(Lagrange, ReproducesPolynomials) {
+    for (int order : {3, 5, 7, 9}) {
+        visit_lag_order(order, [&](auto O) {
+            using Lag = Lagrange<decltype(O)::value>;
+            for (real_t frac : {0., 0.25, 0.5, 0.9}) {
+                const real_t px = Lag::offset + frac;
+                const auto coef = Lag::basis(px);
+                for (int d = 0; d <= Lag::order; ++d) {
+                    real_t value = 0.;
+                    for (int k = 0; k < Lag::pts; ++k)
+                        value += coef[k] * std::pow(real_t(k), d);
+                    EXPECT_NEAR(value, std::pow(px, d),
+                                1e-9 * std::pow(real_t(Lag::pts), d));
+                }
+            }
+        });
+    }
+    EXPECT_THROW(visit_lag_order(4, [](auto) {}), std::invalid_argument);
+}
+
+// =============================================================================
+/* On a coarse grid, each order is more accurate than the previous one */
+TEST(Lagrange, HigherOrdersAreMoreAccurate) {
+    sycl::queue Q;
+    auto params = solver_params();
+    params.n1 = 64;
+    params.update_deltas();
+
+    real_t previous_err = 1;
+    for (int order : {3, 5, 7, 9}) {
+        const auto err = visit_lag_order(order, [&](auto O) {
+            return steps_error(Q, params,
+                               LagrangeSolver<decltype(O)::value>(params));
+        });
+        EXPECT_LT(err, previous_err);
+        previous_err = err;
+    }
+}
+
+// =============================================================================
+/* Line length of the production runs, with a specialized solver */
+static ADVParams
+fixed_n1_params() {
+    auto params = solver_params();
+    params.n1 = 512;
+    params.update_deltas();
+    return params;
+}
+
+TEST(FixedN1, StencilMatchesGenericSolver) {
+    const auto params = fixed_n1_params();
+    std::vector<real_t> line(params.n1);
+    for (size_t i = 0; i < params.n1; ++i)
+        line[i] = std::sin(0.3 * i) + i % 7;
+
+    using Fixed = LagrangeSolver<LAG_ORDER, 512>;
+    static_assert(FixedN1<Fixed>::value == 512);
+    static_assert(FixedN1<AdvectionSolver>::value == 0);
+    for (size_t i0 = 0; i0 < params.n0; ++i0)
+        for (size_t i1 = 0; i1 < params.n1; ++i1)
+            EXPECT_EQ(Fixed::solve(params, HostLine{&line}, i0, i1),
+                      AdvectionSolver::solve(params, HostLine{&line}, i0,
+                                             i1));
+}
+
+// =============================================================================
+TEST(FixedN1, StepsMatchGenericKernels) {
+    sycl::queue Q;
+    const auto params = fixed_n1_params();
+    AdvectionCoefCache cache(Q, params);
+
+    const auto expected = run_steps(Q, params, AdvectionSolver(params));
+    const auto fixed =
+        run_steps(Q, params, LagrangeSolver<LAG_ORDER, 512>(params));
+    const auto cached = run_steps(Q, params, cache.solver<512>());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_NEAR(fixed[i], expected[i], EPS);
+        EXPECT_NEAR(cached[i], expected[i], EPS);
+    }
+}
+
+// =============================================================================
+TEST(FixedN1, RejectsOtherLengths) {
+    sycl::queue Q;
+    const auto params = solver_params();
+    EXPECT_THROW((LagrangeSolver<LAG_ORDER, 512>(params)),
+                 std::invalid_argument);
+
+    AdvectionCoefCache cache(Q, params);
+    EXPECT_THROW(cache.solver<512>(), std::invalid_argument);
+
+    /* Other lengths fall back to the generic solver */
+    EXPECT_EQ(visit_fixed_n1(params.n1, [](auto N) { return N(); }), 0u);
+}
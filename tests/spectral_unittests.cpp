@@ -0,0 +1,90 @@
+#include "gtest/gtest.h"
+#include <AdvectionParams.hpp>
+#include <AdvectionSolver.hpp>
+#include <SpectralSolver.hpp>
+#include <cmath>
+#include <sycl/sycl.hpp>
+#include <utility>
+#include <vector>
+#include <bkma.hpp>
+#include "test_helpers.hpp"
+
+static constexpr size_t N_STEPS = 5;
+
+// =============================================================================
+static ADVParams
+spectral_params(const size_t n1) {
+    return shifting_params(16, n1, 4, N_STEPS);
+}
+
+/* Mean, third and Nyquist modes of a line of n1 cells, shifted by s cells */
+static real_t
+modes(const size_t i, const size_t n1, const real_t s) {
+    const real_t x = (i - s) / n1;
+    return 0.7 + std::sin(2 * M_PI * x) + 0.5 * std::cos(6 * M_PI * x) +
+           0.2 * std::cos(M_PI * i) * std::cos(M_PI * s);
+}
+
+// =============================================================================
+/* The passes and the last stage run on the host shift the line exactly,
+Nyquist mode included */
+TEST(Spectral, ShiftsLinesExactly) {
+    for (size_t n1 : {8, 16, 64, 256}) {
+        const auto params = spectral_params(n1);
+        const SpectralSolver solver(params);
+        for (size_t i0 : {0, 3, 11}) {
+            std::vector<real_t> src(n1), dst(n1);
+            for (size_t i = 0; i < n1; ++i)
+                src[i] = modes(i, n1, 0);
+
+            for (int p = 0; p < solver.line_passes(); ++p) {
+                for (size_t i = 0; i < n1; ++i)
+                    dst[i] = solver.line_pass(HostLine{&src}, p, i0, i, 0);
+                std::swap(src, dst);
+            }
+            for (size_t i = 0; i < n1; ++i)
+                EXPECT_NEAR(solver(HostLine{&src}, i0, i, 0),
+                            modes(i, n1, solver.cells(i0)), 1e-12)
+                    << "n1 = " << n1 << ", i0 = " << i0 << ", i = " << i;
+        }
+    }
+}
+
+// =============================================================================
+TEST(Spectral, RejectsOtherLengths) {
+    for (size_t n1 : {2, 6, 100})
+        EXPECT_THROW(SpectralSolver(spectral_params(n1)),
+                     std::invalid_argument);
+}
+
+// =============================================================================
+/* The initial condition is band limited: the spectral steps are exact, in
+local memory and through the global scratch */
+TEST(Spectral, StepsAreExact) {
+    sycl::queue Q;
+    const auto params = spectral_params(128);
+    const SpectralSolver solver(params);
+
+    for (auto mem_space : {MemorySpace::Local, MemorySpace::Global})
+        EXPECT_LT(steps_error(Q, params, solver, mem_space), 1e-12);
+}
+
+// =============================================================================
+/* Lines whose two tiles, or even one line, do not fit in local memory: the
+default dispatch runs the passes in the global scratch */
+TEST(Spectral, LongLinesRunInTheGlobalScratch) {
+    sycl::queue Q;
+    const auto &dev = DeviceProfile::get(Q.get_device());
+    size_t n1 = 4;
+    while (2 * n1 * sizeof(real_t) <= dev.local_mem_size)
+        n1 *= 2;
+
+    for (auto long_n1 : {n1, 2 * n1}) {
+        const auto params = shifting_params(2, long_n1, 2, N_STEPS);
+        const SpectralSolver solver(params);
+        EXPECT_EQ(create_optim_params<ADVParams>(Q, params, true).mem_space,
+                  MemorySpace::Global)
+            << "n1 = " << long_n1;
+        EXPECT_LT(steps_error(Q, params, solver), 1e-11) << "n1 = " << long_n1;
+    }
+}
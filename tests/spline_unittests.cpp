@@ -0,0 +1,135 @@
+#include "gtest/gtest.h"
+#include <AdvectionParams.hpp>
+#include <AdvectionSolver.hpp>
+#include <SplineSolver.hpp>
+#include <cmath>
+#include <sycl/sycl.hpp>
+#include <utility>
+#include <vector>
+#include <bkma.hpp>
+#include "test_helpers.hpp"
+
+static constexpr size_t N_STEPS = 5;
+
+// =============================================================================
+static ADVParams
+spline_params() {
+    return shifting_params(16, 128, 4, N_STEPS);
+}
+
+/* Spline coefficients of f, the line passes run on the host */
+static std::vector<real_t>
+host_coefficients(const std::vector<real_t> &f) {
+    auto src = f;
+    std::vector<real_t> dst(f.size());
+    for (int p = 0; p < SplineSolver::n_levels; ++p) {
+        for (size_t i = 0; i < f.size(); ++i)
+            dst[i] = SplineSolver::reduce(HostLine{&src}, p, i, f.size());
+        std::swap(src, dst);
+    }
+    return src;
+}
+
+// =============================================================================
+/* Lengths smaller and not multiple of the strides of the reduction */
+TEST(Spline, ReductionSolvesPeriodicSystem) {
+    for (size_t n1 : {1, 3, 5, 16, 100, 1024}) {
+        std::vector<real_t> f(n1);
+        for (size_t i = 0; i < n1; ++i)
+            f[i] = std::sin(0.3 * i) + i % 3;
+
+        const auto eta = host_coefficients(f);
+        for (size_t i = 0; i < n1; ++i) {
+            const auto left = eta[(i + n1 - 1) % n1];
+            const auto right = eta[(i + 1) % n1];
+            EXPECT_NEAR((left + 4 * eta[i] + right) / 6, f[i], 1e-13)
+                << "n1 = " << n1 << ", i = " << i;
+        }
+    }
+}
+
+// =============================================================================
+/* The spline goes through the data at the nodes */
+TEST(Spline, InterpolatesTheNodes) {
+    auto params = spline_params();
+    params.dt = 0;
+    std::vector<real_t> f(params.n1);
+    for (size_t i = 0; i < params.n1; ++i)
+        f[i] = std::cos(0.7 * i) - i % 5;
+
+    const auto eta = host_coefficients(f);
+    for (size_t i0 = 0; i0 < params.n0; ++i0)
+        for (size_t i1 = 0; i1 < params.n1; ++i1)
+            EXPECT_NEAR(SplineSolver::solve(params, HostLine{&eta}, i0, i1),
+                        f[i1], 1e-12);
+}
+
+// =============================================================================
+/* Run with the AdaptiveWg local kernel: cubic splines are more accurate
+than the Lagrange interpolation of order 3 */
+TEST(Spline, StepsAreAccurate) {
+    sycl::queue Q;
+    const auto params = spline_params();
+
+    const auto spline_err =
+        steps_error(Q, params, SplineSolver(params), MemorySpace::Local);
+    EXPECT_LT(spline_err, 1e-5);
+    EXPECT_LT(spline_err, steps_error(Q, params, LagrangeSolver<3>(params),
+                                      MemorySpace::Local));
+}
+
+// =============================================================================
+/* Lines too long for the local memory run the passes in the global scratch */
+TEST(Spline, GlobalScratchMatchesLocal) {
+    sycl::queue Q;
+    const auto params = spline_params();
+    const SplineSolver solver(params);
+
+    const auto local = run_steps(Q, params, solver, MemorySpace::Local);
+    const auto global = run_steps(Q, params, solver, MemorySpace::Global);
+    for (size_t i = 0; i < local.size(); ++i)
+        EXPECT_NEAR(global[i], local[i], 1e-13);
+}
+
+// =============================================================================
+TEST(Spline, NeedsTheAdaptiveWgKernel) {
+    sycl::queue Q;
+    const auto params = spline_params();
+    const SplineSolver solver(params);
+    span3d_t data(sycl_alloc(params.n0 * params.n1 * params.n2, Q),
+                  params.n0, params.n1, params.n2);
+
+    auto optim_params = create_optim_params<ADVParams>(Q, params);
+    EXPECT_THROW((bkma_run<SplineSolver, BkmaImpl::NDRange>(
+                     Q, data, solver, optim_params)),
+                 std::invalid_argument);
+    sycl::free(data.data_handle(), Q);
+}
+
+// =============================================================================
+/* One line of n1 cells fits in local memory but not the two tiles of the
+line passes: the default dispatch falls back to the global scratch */
+TEST(Spline, TwoTilesOverLocalMemoryRunGlobal) {
+    sycl::queue Q;
+    const auto &dev = DeviceProfile::get(Q.get_device());
+    size_t n1 = 1;
+    while (2 * n1 * sizeof(real_t) <= dev.local_mem_size)
+        n1 *= 2;
+    ASSERT_GT(2 * n1 * sizeof(real_t), dev.local_mem_size);
+    ASSERT_LE(n1 * sizeof(real_t), dev.local_mem_size);
+
+    const auto params = shifting_params(2, n1, 2, N_STEPS);
+    const SplineSolver solver(params);
+    ASSERT_NE(create_optim_params<ADVParams>(Q, params).mem_space,
+              MemorySpace::Global);
+    const auto optim_params = create_optim_params<ADVParams>(Q, params, true);
+    EXPECT_EQ(optim_params.mem_space, MemorySpace::Global);
+
+    auto local_params = optim_params;
+    local_params.mem_space = MemorySpace::Local;
+    EXPECT_FALSE(impl_unsupported(BkmaImpl::AdaptiveWg, dev, local_params,
+                                  n1, 1, true)
+                     .empty());
+
+    EXPECT_LT(steps_error(Q, params, solver), 1e-5);
+}
@@ -0,0 +1,92 @@
+#include "gtest/gtest.h"
+#include <AdvectionParams.hpp>
+#include <AdvectionSolver.hpp>
+#include <SpectralSolver.hpp>
+#include <SplineSolver.hpp>
+#include <sycl/sycl.hpp>
+#include <tuple>
+#include <vector>
+#include <bkma.hpp>
+#include "test_helpers.hpp"
+
+static constexpr double EPS = 1e-14;
+static constexpr size_t N_STEPS = 3;
+
+// =============================================================================
+/* Reads the two cells left of i1, checks the window offset of the outputs */
+struct WindowSolver {
+    auto inline constexpr window() const { return 3; }
+
+    template <class ArrayLike1D>
+    inline real_t operator()(const ArrayLike1D data, const size_t &,
+                             const size_t &i1, const size_t &) const {
+        return data(i1) + 2 * data(i1 - 1) + 3 * data(i1 - 2);
+    }
+};
+
+/* Shapes with tiles ragged in dim0 (w0 = 2 for 5 x 16 x 1) and dim2
+(w2 = 32 for 2 x 32 x 33), and long strides */
+static std::vector<ADVParams>
+staging_params() {
+    std::vector<ADVParams> shapes;
+    for (auto [n0, n1, n2] :
+         {std::tuple{3, 64, 7}, std::tuple{5, 128, 1}, std::tuple{5, 16, 1},
+          std::tuple{2, 32, 33}, std::tuple{16, 256, 64}}) {
+        ADVParams params;
+        params.n0 = n0;
+        params.n1 = n1;
+        params.n2 = n2;
+        params.maxIter = N_STEPS;
+        params.pref_wg_size = 32;
+        params.seq_size0 = 1;
+        params.seq_size2 = 1;
+        params.update_deltas();
+        shapes.push_back(params);
+    }
+    return shapes;
+}
+
+// =============================================================================
+TEST(Staging, AdvectionMatchesGlobalScratch) {
+    sycl::queue Q;
+    for (const auto &params : staging_params()) {
+        const AdvectionSolver solver(params);
+        const auto staged = run_steps(Q, params, solver, MemorySpace::Local);
+        const auto global =
+            run_steps(Q, params, solver, MemorySpace::Global);
+        for (size_t i = 0; i < global.size(); ++i)
+            EXPECT_NEAR(staged[i], global[i], EPS);
+    }
+}
+
+// =============================================================================
+TEST(Staging, WindowMatchesGlobalScratch) {
+    sycl::queue Q;
+    for (const auto &params : staging_params()) {
+        const auto staged =
+            run_steps(Q, params, WindowSolver{}, MemorySpace::Local);
+        const auto global =
+            run_steps(Q, params, WindowSolver{}, MemorySpace::Global);
+        for (size_t i = 0; i < global.size(); ++i)
+            EXPECT_NEAR(staged[i], global[i], EPS * (1 << 3 * N_STEPS));
+    }
+}
+
+// =============================================================================
+/* The line passes through the global scratch, with work-items of a
+work-group making different numbers of trips over the lines */
+TEST(Staging, LinePassesMatchGlobalScratch) {
+    sycl::queue Q;
+    for (const auto &params : staging_params()) {
+        auto check = [&](const auto &solver) {
+            const auto staged =
+                run_steps(Q, params, solver, MemorySpace::Local);
+            const auto global =
+                run_steps(Q, params, solver, MemorySpace::Global);
+            for (size_t i = 0; i < global.size(); ++i)
+                EXPECT_NEAR(staged[i], global[i], 1e-13);
+        };
+        check(SplineSolver(params));
+        check(SpectralSolver(params));
+    }
+}
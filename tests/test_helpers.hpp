@@ -0,0 +1,95 @@
+#pragma once
+#include <AdvectionParams.hpp>
+#include <optional>
+#include <sycl/sycl.hpp>
+#include <vector>
+#include <bkma.hpp>
+#include <init.hpp>
+#include <validation.hpp>
+
+// =============================================================================
+/* Velocities covering shifts of several cells in both directions */
+inline ADVParams
+shifting_params(const size_t n0, const size_t n1, const size_t n2,
+                const size_t n_steps) {
+    ADVParams params;
+    params.n0 = n0;
+    params.n1 = n1;
+    params.n2 = n2;
+    params.dt = 0.0137;
+    params.minRealVx = -3;
+    params.maxRealVx = 3;
+    params.maxIter = n_steps;
+    params.pref_wg_size = 64;
+    params.seq_size0 = 1;
+    params.seq_size2 = 1;
+    params.update_deltas();
+    return params;
+}
+
+/* Line accessor over a host vector */
+struct HostLine {
+    const std::vector<real_t> *cells;
+    real_t operator()(const size_t i) const { return (*cells)[i]; }
+};
+
+// =============================================================================
+/* Advances data by params.maxIter steps of Impl, params.steps_in_flight of
+them enqueued ahead, with a BkmaContext of its own. The dispatch is the one
+of create_optim_params, in mem_space if given. */
+template <class MySolver, BkmaImpl Impl = BkmaImpl::AdaptiveWg>
+inline void
+advance(sycl::queue &Q, span3d_t data, const ADVParams &params,
+        const MySolver &solver,
+        const std::optional<MemorySpace> mem_space = std::nullopt) {
+    BkmaContext ctx(Q);
+    auto optim_params = create_optim_params<ADVParams>(
+        Q, params, HasLinePasses<MySolver>::value);
+    if (mem_space)
+        optim_params.mem_space = *mem_space;
+    if constexpr (Impl == BkmaImpl::Persistent)
+        optim_params.work_counters = ctx.work_counters();
+
+    const auto nw = params.n1 - (solver.window() - 1);
+    StepsInFlight steps(params.steps_in_flight);
+    for (size_t t = 0; t < params.maxIter; ++t)
+        steps.push([&](const std::vector<sycl::event> &deps) {
+            return bkma_run<MySolver, Impl>(Q, data, solver, optim_params,
+                                            ctx.scratch(optim_params, nw),
+                                            deps);
+        });
+    steps.wait();
+}
+
+// =============================================================================
+/* Runs the advection of params from its initial condition, returns the
+distribution on the host */
+template <class MySolver, BkmaImpl Impl = BkmaImpl::AdaptiveWg>
+inline std::vector<real_t>
+run_steps(sycl::queue &Q, const ADVParams &params, const MySolver &solver,
+          const std::optional<MemorySpace> mem_space = std::nullopt) {
+    const auto n_cells = params.n0 * params.n1 * params.n2;
+    span3d_t data(sycl_alloc(n_cells, Q), params.n0, params.n1, params.n2);
+    fill_buffer_adv(Q, data, params);
+    advance<MySolver, Impl>(Q, data, params, solver, mem_space);
+
+    std::vector<real_t> result(n_cells);
+    Q.copy(data.data_handle(), result.data(), n_cells).wait();
+    sycl::free(data.data_handle(), Q);
+    return result;
+}
+
+/* Same run, returns the error against the analytical solution */
+template <class MySolver, BkmaImpl Impl = BkmaImpl::AdaptiveWg>
+inline real_t
+steps_error(sycl::queue &Q, const ADVParams &params, const MySolver &solver,
+            const std::optional<MemorySpace> mem_space = std::nullopt) {
+    span3d_t data(sycl_alloc(params.n0 * params.n1 * params.n2, Q), params.n0,
+                  params.n1, params.n2);
+    fill_buffer_adv(Q, data, params);
+    advance<MySolver, Impl>(Q, data, params, solver, mem_space);
+
+    const auto err = validate_result_adv(Q, data, params, false);
+    sycl::free(data.data_handle(), Q);
+    return err;
+}